@@ -10,11 +10,13 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 
-#define clear_block(addr) \
-__asm__("cld\n\t" \
+#define clear_block(addr) ({ \
+int __d0,__d1; \
+__asm__ __volatile__("cld\n\t" \
 	"rep\n\t" \
 	"stosl" \
-	::"a" (0),"c" (BLOCK_SIZE/4),"D" ((long) (addr)):"cx","di")
+	:"=c" (__d0),"=D" (__d1) \
+	:"a" (0),"0" (BLOCK_SIZE/4),"1" ((long) (addr)):"memory"); })
 
 //把指定地址开始的第nr个位偏移处的比特位置位
 #define set_bit(nr,addr) ({\
@@ -30,7 +32,7 @@ __asm__ __volatile__("btrl %2,%3\n\tsetnb %%al": \
 res;})
 
 #define find_first_zero(addr) ({ \
-int __res; \
+int __res,__d0; \
 __asm__("cld\n" \
 	"1:\tlodsl\n\t" \
 	"notl %%eax\n\t" \
@@ -42,81 +44,173 @@ __asm__("cld\n" \
 	"cmpl $8192,%%ecx\n\t" \
 	"jl 1b\n" \
 	"3:" \
-	:"=c" (__res):"c" (0),"S" (addr):"ax","dx","si"); \
+	:"=c" (__res),"=S" (__d0):"0" (0),"1" (addr):"ax","dx","memory"); \
 __res;})
 
-//释放设备dev上数据区中的逻辑块block
-void free_block(int dev, int block)
+#define test_bit(nr,addr) \
+(((unsigned char *) (addr))[(nr)>>3] & (1<<((nr)&7)))
+
+/*
+ * free_zones() gives back the run of count zones starting at block. The
+ * cached buffers of the zones are thrown away, and each bitmap buffer
+ * the run touches is marked dirty (and logged) once, not once per zone.
+ */
+void free_zones(int dev, int block, int count)
 {
 	struct super_block * sb;
-	struct buffer_head * bh;
+	struct buffer_head * bh, * map = NULL;
+	int i,n;
 
 	if (!(sb = get_super(dev)))
 		panic("trying to free block on nonexistent device");
-	if (block < sb->s_firstdatazone || block >= sb->s_nzones)
+	if (block < sb->s_firstdatazone || block+count > sb->s_zones)
 		panic("trying to free block not in datazone");
-	bh = get_hash_table(dev,block);
-	if (bh) {
-		if (bh->b_count != 1) {
-			printk("trying to free block (%04x:%d), count=%d\n",
-				dev,block,bh->b_count);
-			return;
+	for ( ; count-- > 0 ; block++) {
+		//逻辑块中各盘块在高速缓冲中的内容都要作废
+		for (i=0 ; i < (1<<sb->s_log_zone_size) ; i++) {
+			if (!(bh = get_hash_table(dev,(block<<sb->s_log_zone_size)+i)))
+				continue;
+			//钉在日志事务中的块要先从事务中去掉
+			if (bh->b_jtrans)
+				journal_forget(bh);
+			if (bh->b_count != 1) {
+				printk("trying to free block (%04x:%d), count=%d\n",
+					dev,block,bh->b_count);
+				break;
+			}
+			bh->b_dirt=0;
+			bh->b_uptodate=0;
+			brelse(bh);
 		}
-		bh->b_dirt=0;
-		bh->b_uptodate=0;
-		brelse(bh);
-	}
-	//接着复位block在逻辑块位图中的比特位(置0)
-	block -= sb->s_firstdatazone - 1 ;
-	if (clear_bit(block&8191,sb->s_zmap[block/8192]->b_data)) {
-		printk("block (%04x:%d) ",dev,block+sb->s_firstdatazone-1);
-		panic("free_block: bit already cleared");
+		//还有人在用的块不释放
+		if (i < (1<<sb->s_log_zone_size))
+			continue;
+		//接着复位block在逻辑块位图中的比特位(置0)
+		n = block - (sb->s_firstdatazone - 1);
+		if (map != sb->s_zmap[n/8192]) {
+			if (map)
+				journal_dirty(map);
+			map = sb->s_zmap[n/8192];
+		}
+		if (clear_bit(n&8191,map->b_data)) {
+			printk("block (%04x:%d) ",dev,block);
+			panic("free_block: bit already cleared");
+		}
+		sb->s_zfree++;
 	}
-	sb->s_zmap[block/8192]->b_dirt = 1;
+	if (map)
+		journal_dirty(map);
+}
+
+//释放设备dev上数据区中的逻辑块block
+void free_block(int dev, int block)
+{
+	free_zones(dev,block,1);
 }
 
 //向设备申请一个逻辑块号
 //函数首先取得设备的超级块,并在超级块中的逻辑块位图中寻找第一个0值比特位(代表一个空闲逻辑块)
 //然后置位对应逻辑块在逻辑块位图中的比特位,接着从设备上读取该逻辑块到高速缓冲区中
 //最后将新逻辑块清零,并设置其已更新标志和已修改标志,并返回逻辑块号
+//一个逻辑块含有多个盘块时，每个盘块都要清零
+//已答应给延迟写数据的块(s_zdelay)不能给别人，只有reserved置位时(由alloc_delayed()分配)才能用
 //函数执行成功则返回逻辑块号,否则返回0
-int new_block(int dev)
+int new_block(int dev, int reserved)
 {
 	struct buffer_head * bh;
 	struct super_block * sb;
-	int i,j;
+	int i,j,k;
 
 	//首先获取设备dev的超级块
 	if (!(sb = get_super(dev)))
 		panic("trying to get new block from nonexistant device");
-	//然后扫描文件系统的 8块逻辑块位图,寻找第1个0值位,以寻找空闲逻辑块
+	//超级块中记有空闲逻辑块数，设备已满时不必扫描位图
+	//不过等待释放的已删除文件可能还占着块，先把它们释放掉
+	if (sb->s_zfree <= (reserved ? 0 : sb->s_zdelay))
+		reclaim_inodes(dev);
+	if (sb->s_zfree <= (reserved ? 0 : sb->s_zdelay))
+		return 0;
+	//然后扫描文件系统的逻辑块位图,寻找第1个0值位,以寻找空闲逻辑块
 	j = 8192;
-	for (i=0 ; i<8 ; i++)
+	for (i=0 ; i<sb->s_zmap_blocks ; i++)
 		if (bh=sb->s_zmap[i])
 			if ((j=find_first_zero(bh->b_data))<8192)
 				break;
-	if (i>=8 || !bh || j>=8192)
+	if (i>=sb->s_zmap_blocks || !bh || j>=8192)
+		return 0;
+	if (j + i*8192 + sb->s_firstdatazone-1 >= sb->s_zones)
 		return 0;
 	//接着设置找到的新逻辑块j对应逻辑块位图中的比特位
 	if (set_bit(j,bh->b_data))
 		panic("new_block: bit already set");
-	bh->b_dirt = 1;
+	journal_dirty(bh);
+	sb->s_zfree--;
 	j += i*8192 + sb->s_firstdatazone-1;
-	if (j >= sb->s_nzones)
-		return 0;
-	//然后在高速缓冲区中为该设备上指定的逻辑块号取得一个缓冲块,并返回缓冲块头指针
-	if (!(bh=getblk(dev,j)))
-		panic("new_block: cannot get block");
-	if (bh->b_count != 1)
-		panic("new block: count is != 1");
-	//最后将新逻辑块清零
-	clear_block(bh->b_data);
-	bh->b_uptodate = 1;
-	bh->b_dirt = 1;
-	brelse(bh);
+	//然后在高速缓冲区中为该逻辑块的各盘块取得缓冲块,并将其清零
+	for (k=0 ; k < (1<<sb->s_log_zone_size) ; k++) {
+		if (!(bh=getblk(dev,(j<<sb->s_log_zone_size)+k)))
+			panic("new_block: cannot get block");
+		if (bh->b_count != 1)
+			panic("new block: count is != 1");
+		clear_block(bh->b_data);
+		bh->b_uptodate = 1;
+		bh->b_dirt = 1;
+		brelse(bh);
+	}
 	return j;
 }
 
+/*
+ * new_zones() reserves a run of up to *count free zones, preferably
+ * starting at 'goal', and returns the first one (0 if the device is
+ * full). *count is set to the length actually obtained. Unlike
+ * new_block() the zones are not cleared or read into the buffer cache -
+ * the caller already has the data for them. Only alloc_delayed() calls
+ * it, for zones reserved in s_zdelay, so those count as free here.
+ */
+int new_zones(int dev, int goal, int * count)
+{
+	struct buffer_head * bh;
+	struct super_block * sb;
+	int nbits,i,j,n;
+
+	if (!(sb = get_super(dev)))
+		panic("trying to get new block from nonexistant device");
+	if (!sb->s_zfree)
+		reclaim_inodes(dev);
+	if (!sb->s_zfree)
+		return 0;
+	nbits = sb->s_zones - sb->s_firstdatazone + 1;
+	//先在目标块之后(同一块位图范围内)找空闲位，找不到再从头找第1个0值位
+	i = nbits;
+	if (goal >= sb->s_firstdatazone && goal < sb->s_zones) {
+		i = goal - sb->s_firstdatazone + 1;
+		for (j = i+8192 ; i < nbits && i < j ; i++)
+			if (!test_bit(i&8191,sb->s_zmap[i>>13]->b_data))
+				break;
+		if (i >= j)
+			i = nbits;
+	}
+	if (i >= nbits) {
+		for (n=0,j=8192 ; n<sb->s_zmap_blocks ; n++)
+			if (bh=sb->s_zmap[n])
+				if ((j=find_first_zero(bh->b_data))<8192)
+					break;
+		if (n>=sb->s_zmap_blocks || j>=8192 || (i = j+n*8192) >= nbits)
+			return 0;
+	}
+	//然后尽量向后延伸，把连续的空闲位一起置位
+	for (n=0 ; n < *count && i+n < nbits ; n++) {
+		bh = sb->s_zmap[(i+n)>>13];
+		if (set_bit((i+n)&8191,bh->b_data))
+			break;
+		journal_dirty(bh);
+	}
+	sb->s_zfree -= n;
+	*count = n;
+	return i + sb->s_firstdatazone-1;
+}
+
 //释放指定的i节点
 void free_inode(struct m_inode * inode)
 {
@@ -148,14 +242,47 @@ void free_inode(struct m_inode * inode)
 	//复位i节点对应的节点位图中的比特位
 	if (clear_bit(inode->i_num&8191,bh->b_data))
 		printk("free_inode: bit already cleared.\n\r");
-	bh->b_dirt = 1;
+	else
+		sb->s_ifree++;
+	journal_dirty(bh);
 	//清空i节点结构所占的内存区
 	memset(inode,0,sizeof(*inode));
 }
 
+/*
+ * find_near_inode() looks for a free inode in the same inode-table block
+ * as inode 'near' (normally the parent directory), then in the blocks
+ * around it, so that the inodes of one directory share a few blocks and
+ * a stat() of every entry doesn't read a new block each time.
+ */
+#define NEAR_INODE_BLOCKS 8
+
+static int find_near_inode(struct super_block * sb, int near)
+{
+	int blk,d,b,nr,last;
+
+	if (near < 1 || near > sb->s_ninodes)
+		return 0;
+	blk = (near-1)/INODES_PER_BLOCK(sb);
+	for (d=0 ; d<NEAR_INODE_BLOCKS ; d++)
+		for (b = blk+d ; b >= blk-d ; b -= d?2*d:1) {
+			if (b < 0)
+				continue;
+			nr = b*INODES_PER_BLOCK(sb)+1;
+			last = nr+INODES_PER_BLOCK(sb)-1;
+			if (last > sb->s_ninodes)
+				last = sb->s_ninodes;
+			for ( ; nr <= last ; nr++)
+				if (!test_bit(nr&8191,sb->s_imap[nr>>13]->b_data))
+					return nr;
+		}
+	return 0;
+}
+
 //为设备dev建立一个新i节点，初始化并返回该新i节点的指针
 //在内存i节点表中获取一个空闲i节点表项，并从i节点位图中找一个空闲i节点
-struct m_inode * new_inode(int dev)
+//near是希望靠近的i节点号(通常是所在目录)，为0表示没有要求
+struct m_inode * new_inode(int dev, int near)
 {
 	struct m_inode * inode;
 	struct super_block * sb;
@@ -167,13 +294,25 @@ struct m_inode * new_inode(int dev)
 		return NULL;
 	if (!(sb = get_super(dev)))
 		panic("new_inode with unknown device");
-	//然后扫描超级块中8块i节点 位图，寻找第一个0位，
-	//寻找空闲节点，获取放置该i节点的节点号
-	j = 8192;
-	for (i=0 ; i<8 ; i++)
-		if (bh=sb->s_imap[i])
-			if ((j=find_first_zero(bh->b_data))<8192)
-				break;
+	if (!sb->s_ifree)
+		reclaim_inodes(dev);
+	if (!sb->s_ifree) {
+		iput(inode);
+		return NULL;
+	}
+	//先在near附近的i节点块中找空闲i节点，找不到再扫描超级块中的i节点位图，
+	//寻找第一个0位，获取放置该i节点的节点号
+	if (j = find_near_inode(sb,near)) {
+		i = j>>13;
+		bh = sb->s_imap[i];
+		j &= 8191;
+	} else {
+		j = 8192;
+		for (i=0 ; i<sb->s_imap_blocks ; i++)
+			if (bh=sb->s_imap[i])
+				if ((j=find_first_zero(bh->b_data))<8192)
+					break;
+	}
 	if (!bh || j >= 8192 || j+i*8192 > sb->s_ninodes) {
 		iput(inode);
 		return NULL;
@@ -183,7 +322,8 @@ struct m_inode * new_inode(int dev)
 	if (set_bit(j,bh->b_data))
 		panic("new_inode: bit already set");
 	//置i节点位图所在缓冲块已修改标志
-	bh->b_dirt = 1;
+	journal_dirty(bh);
+	sb->s_ifree--;
 	//最后初始化该i节点结构
 	inode->i_count=1;
 	inode->i_nlinks=1;
@@ -192,6 +332,7 @@ struct m_inode * new_inode(int dev)
 	inode->i_gid=current->egid;
 	inode->i_dirt=1;
 	inode->i_num = j + i*8192;		//对应设备的i节点号
+	inode->i_op = &minix_inode_operations;
 	inode->i_mtime = inode->i_atime = inode->i_ctime = CURRENT_TIME;
 	return inode;
 }
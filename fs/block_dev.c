@@ -5,13 +5,45 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <asm/segment.h>
 #include <asm/system.h>
 
-int block_write(int dev, long * pos, char * buf, int count)
+/*
+ * O_DIRECT on a block device: whole blocks from a block-aligned *pos
+ * into or out of a block-aligned user buffer go straight to the driver
+ * (see direct_rw()). Only for user-space buffers (fs = 0x17), not for
+ * kernel callers such as sendfile(). Returns the bytes done, the rest
+ * is left to the ordinary code.
+ */
+static int block_direct(int rw, int dev, long * pos, char * buf, int count)
+{
+	int nr[DIRECT_BATCH];
+	int i,n,chars,done = 0;
+
+	if ((*pos & (BLOCK_SIZE-1)) || ((unsigned long) buf & (BLOCK_SIZE-1)))
+		return 0;
+	while ((n = count/BLOCK_SIZE) > 0) {
+		if (n > DIRECT_BATCH)
+			n = DIRECT_BATCH;
+		for (i=0 ; i<n ; i++)
+			nr[i] = (*pos >> BLOCK_SIZE_BITS) + i;
+		if ((chars = direct_rw(rw,dev,nr,n,buf)) <= 0)
+			break;
+		*pos += chars;
+		buf += chars;
+		done += chars;
+		count -= chars;
+		if (chars < n*BLOCK_SIZE)
+			break;
+	}
+	return done;
+}
+
+int block_write(int dev, long * pos, char * buf, int count, int flags)
 {
 	int block = *pos >> BLOCK_SIZE_BITS;
 	int offset = *pos & (BLOCK_SIZE-1);
@@ -20,6 +52,15 @@ int block_write(int dev, long * pos, char * buf, int count)
 	struct buffer_head * bh;
 	register char * p;
 
+	//只读设备不能写，否则ll_rw_block()丢掉数据后这里还会报告成功
+	if (is_read_only(dev))
+		return -EROFS;
+	if ((flags & O_DIRECT) && get_fs() == 0x17) {
+		written = block_direct(WRITE,dev,pos,buf,count);
+		buf += written;
+		count -= written;
+		block = *pos >> BLOCK_SIZE_BITS;
+	}
 	while (count>0) {
 		chars = BLOCK_SIZE - offset;
 		if (chars > count)
@@ -36,15 +77,16 @@ int block_write(int dev, long * pos, char * buf, int count)
 		*pos += chars;
 		written += chars;
 		count -= chars;
-		while (chars-->0)
-			*(p++) = get_fs_byte(buf++);
+		memcpy_fromfs(p,buf,chars);
+		buf += chars;
+		bh->b_uptodate = 1;
 		bh->b_dirt = 1;
 		brelse(bh);
 	}
 	return written;
 }
 
-int block_read(int dev, unsigned long * pos, char * buf, int count)
+int block_read(int dev, unsigned long * pos, char * buf, int count, int flags)
 {
 	int block = *pos >> BLOCK_SIZE_BITS;
 	int offset = *pos & (BLOCK_SIZE-1);
@@ -53,6 +95,12 @@ int block_read(int dev, unsigned long * pos, char * buf, int count)
 	struct buffer_head * bh;
 	register char * p;
 
+	if ((flags & O_DIRECT) && get_fs() == 0x17) {
+		read = block_direct(READ,dev,(long *) pos,buf,count);
+		buf += read;
+		count -= read;
+		block = *pos >> BLOCK_SIZE_BITS;
+	}
 	while (count>0) {
 		chars = BLOCK_SIZE-offset;
 		if (chars > count)
@@ -65,8 +113,8 @@ int block_read(int dev, unsigned long * pos, char * buf, int count)
 		*pos += chars;
 		read += chars;
 		count -= chars;
-		while (chars-->0)
-			put_fs_byte(*(p++),buf++);
+		memcpy_tofs(buf,p,chars);
+		buf += chars;
 		brelse(bh);
 	}
 	return read;
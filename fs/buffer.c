@@ -19,11 +19,14 @@
  */
 
 #include <stdarg.h>
+#include <errno.h>
+#include <string.h>
  
 #include <linux/config.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <asm/system.h>
+#include <asm/segment.h>
 #include <asm/io.h>
 
 extern int end;
@@ -47,11 +50,14 @@ int sys_sync(void)
 	int i;
 	struct buffer_head * bh;
 
+	reclaim_inodes(0);	/* free the files deleted meanwhile */
+	sync_mmap(NULL);	/* write shared mappings into the files */
 	sync_inodes();		/* write out inodes into buffers */
+	sync_journals();	/* and the metadata into the logs */
 	bh = start_buffer;
 	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
 		wait_on_buffer(bh);
-		if (bh->b_dirt)
+		if (bh->b_dirt && !IS_DELAY_DEV(bh->b_dev))
 			ll_rw_block(WRITE,bh);
 	}
 	return 0;
@@ -62,6 +68,11 @@ int sync_dev(int dev)
 	int i;
 	struct buffer_head * bh;
 
+	//延迟分配的伪设备没有磁盘，先为其中的数据分配磁盘块(缓冲块随之改挂到真实设备上)
+	if (IS_DELAY_DEV(dev)) {
+		alloc_delayed(inode_table+MINOR(dev)-1);
+		return 0;
+	}
 	bh = start_buffer;
 	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
 		if (bh->b_dev != dev)
@@ -171,7 +182,9 @@ static inline void insert_into_queues(struct buffer_head * bh)
 		return;
 	bh->b_next = hash(bh->b_dev,bh->b_blocknr);
 	hash(bh->b_dev,bh->b_blocknr) = bh;
-	bh->b_next->b_prev = bh;
+	//hash队列原来为空时b_next是NULL，不能通过它写(在内核里会写坏页目录)
+	if (bh->b_next)
+		bh->b_next->b_prev = bh;
 }
 
 //利用hash表在高速缓冲中寻找给定设备和指定块号的缓冲区块
@@ -211,6 +224,29 @@ struct buffer_head * get_hash_table(int dev, int block)
 	}
 }
 
+/*
+ * remap_buffer() gives a delayed-allocation buffer its final disk address.
+ * The target block has just been allocated, so any copy of it still in
+ * the cache is stale and is dropped first. Doesn't sleep.
+ */
+void remap_buffer(struct buffer_head * bh, int dev, int block)
+{
+	struct buffer_head * tmp;
+
+	if (tmp = find_buffer(dev,block)) {
+		if (tmp->b_count)
+			printk("remap_buffer: block (%04x:%d) in use\n",dev,block);
+		tmp->b_uptodate = tmp->b_dirt = 0;
+		remove_from_queues(tmp);
+		tmp->b_dev = 0;
+		insert_into_queues(tmp);
+	}
+	remove_from_queues(bh);
+	bh->b_dev = dev;
+	bh->b_blocknr = block;
+	insert_into_queues(bh);
+}
+
 /*
  * Ok, this is getblk, and it isn't very clear, again to hinder
  * race-conditions. Most of the code is seldom used, (ie repeating),
@@ -219,7 +255,9 @@ struct buffer_head * get_hash_table(int dev, int block)
  * The algoritm is changed: hopefully better, and an elusive bug removed.
  */
 //用于同时判断缓冲区的修改标志和锁定标志，并且定义修改标志的权重要比锁定标志大
-#define BADNESS(bh) (((bh)->b_dirt<<1)+(bh)->b_lock)
+//延迟分配的脏块要先分配磁盘块才能写出，最后才选它
+#define BADNESS(bh) (((bh)->b_dirt<<1)+(bh)->b_lock+ \
+	(((bh)->b_dirt && IS_DELAY_DEV((bh)->b_dev))<<2))
 //取高速缓冲中指定的缓冲块
 struct buffer_head * getblk(int dev,int block)
 {
@@ -263,6 +301,11 @@ repeat:
 		wait_on_buffer(bh);
 		if (bh->b_count)
 			goto repeat;
+		//该文件正由本进程分配磁盘块(见alloc_delayed())，只能等别的缓冲块空出来
+		if (bh->b_dirt && IS_DELAY_DEV(bh->b_dev)) {
+			sleep_on(&buffer_wait);
+			goto repeat;
+		}
 	}
 /* NOTE!! While we slept waiting for this block, somebody else might */
 /* already have added "this" block to the cache. check it */
@@ -276,6 +319,7 @@ repeat:
 	bh->b_count=1;
 	bh->b_dirt=0;
 	bh->b_uptodate=0;
+	bh->b_jlog=0;
 	//从hash队列和空闲链表中移除该缓冲区头，让该缓冲区用于指定设备和其上的指定块
 	remove_from_queues(bh);
 	//根据新设备号和块号重新插入空闲链表和hash队列新位置处
@@ -325,12 +369,14 @@ struct buffer_head * bread(int dev,int block)
 
 //复制内存块
 //从from地址复制一块(1024字节)数据到to位置
-#define COPYBLK(from,to) \
-__asm__("cld\n\t" \
+#define COPYBLK(from,to) ({ \
+int __d0,__d1,__d2; \
+__asm__ __volatile__("cld\n\t" \
 	"rep\n\t" \
 	"movsl\n\t" \
-	::"c" (BLOCK_SIZE/4),"S" (from),"D" (to) \
-	:"cx","di","si")
+	:"=c" (__d0),"=S" (__d1),"=D" (__d2) \
+	:"0" (BLOCK_SIZE/4),"1" (from),"2" (to) \
+	:"memory"); })
 
 /*
  * bread_page reads four buffers into memory at the desired address. It's
@@ -393,7 +439,7 @@ struct buffer_head * breada(int dev,int first, ...)
 		tmp=getblk(dev,first);
 		if (tmp) {
 			if (!tmp->b_uptodate)
-				ll_rw_block(READA,bh);
+				ll_rw_block(READA,tmp);
 			//因为上句是预读随后的数据块，只需读进高速缓冲区但并不是马上就使用
 			//所以需要将其引用计数递减释放掉(因为在getblk()函数中会增加引用计数值)
 			tmp->b_count--;
@@ -410,6 +456,127 @@ struct buffer_head * breada(int dev,int first, ...)
 	return (NULL);
 }
 
+/*
+ * direct_rw() moves n whole blocks between the device and the user
+ * buffer buf (BLOCK_SIZE aligned) without going through the buffer
+ * cache. The user pages are pinned and each block gets a private buffer
+ * head whose b_data points into the user page, so the driver transfers
+ * straight to or from it, and make_request() merges consecutive blocks.
+ * nr[i] is the device block of the i:th block, 0 for a hole (read as
+ * zeros, never written). Blocks that are in the cache anyway, and pages
+ * that can't be pinned, are copied through the cache as usual. As the
+ * cache may get a block while its transfer is under way, each block is
+ * looked up again when done: a write updates the cached copy, a read
+ * takes a dirty cached copy over the disk's, so the cache never goes
+ * stale. Returns the number of bytes done, -EIO, or
+ * -EROFS for a write to a read-only device.
+ */
+int direct_rw(int rw, int dev, int * nr, int n, char * buf)
+{
+	struct buffer_head * tmp, * bh;
+	unsigned long page[DIRECT_BATCH];
+	char * p;
+	int i,k,ok,done = 0,err = 0;
+
+	if (rw == WRITE && is_read_only(dev))
+		return -EROFS;
+	if (!(tmp = (struct buffer_head *) get_free_page()))
+		return -ENOMEM;
+	for ( ; n > 0 && !err ; n -= k,nr += k) {
+		k = (n < DIRECT_BATCH) ? n : DIRECT_BATCH;
+		for (i=0 ; i<k ; i++) {
+			page[i] = 0;
+			p = buf + (done+i)*BLOCK_SIZE;
+			if (!nr[i]) {
+				if (rw == READ)
+					clear_fs(p,BLOCK_SIZE);
+				continue;
+			}
+			if (!(bh = get_hash_table(dev,nr[i])) &&
+			    !(page[i] = pin_user_page((unsigned long) p,rw == READ)))
+				bh = (rw == READ) ? bread(dev,nr[i]) : getblk(dev,nr[i]);
+			if (page[i]) {
+				memset(tmp+i,0,sizeof(*tmp));
+				tmp[i].b_data = (char *) (page[i] + ((unsigned long) p & 0xfff));
+				tmp[i].b_dev = dev;
+				tmp[i].b_blocknr = nr[i];
+				tmp[i].b_count = 1;
+				tmp[i].b_uptodate = tmp[i].b_dirt = (rw == WRITE);
+				ll_rw_block(rw,tmp+i);
+				continue;
+			}
+			if (!bh) {
+				err = 1;
+				continue;
+			}
+			if (rw == READ)
+				memcpy_tofs(p,bh->b_data,BLOCK_SIZE);
+			else {
+				memcpy_fromfs(bh->b_data,p,BLOCK_SIZE);
+				bh->b_uptodate = 1;
+				bh->b_dirt = 1;
+			}
+			brelse(bh);
+		}
+		for (i=0 ; i<k ; i++) {
+			if (!page[i])
+				continue;
+			wait_on_buffer(tmp+i);
+			ok = tmp[i].b_uptodate;
+			//传输期间这一块可能进了高速缓冲：写时让缓冲块跟上新数据，
+			//读时若缓冲块已修改则以它为准
+			if (bh = get_hash_table(dev,nr[i])) {
+				if (rw == WRITE) {
+					memcpy(bh->b_data,tmp[i].b_data,BLOCK_SIZE);
+					bh->b_uptodate = 1;
+				} else if (bh->b_dirt) {
+					memcpy(tmp[i].b_data,bh->b_data,BLOCK_SIZE);
+					ok = 1;
+				}
+				brelse(bh);
+			}
+			err |= !ok;
+			free_page(page[i]);
+		}
+		if (!err)
+			done += k;
+	}
+	free_page((unsigned long) tmp);
+	return done ? done*BLOCK_SIZE : (err ? -EIO : 0);
+}
+
+/*
+ * bread_zone() reads a block of a file system with multi-block zones,
+ * and when it has to go to the disk it starts reading the rest of the
+ * zone too. make_request() merges those reads into one request.
+ */
+struct buffer_head * bread_zone(int dev,int block)
+{
+	struct super_block * sb;
+	struct buffer_head * bh, * tmp;
+	int last;
+
+	if (!(sb = get_super(dev)) || !sb->s_log_zone_size)
+		return bread(dev,block);
+	if (!(bh=getblk(dev,block)))
+		panic("bread: getblk returned NULL\n");
+	if (bh->b_uptodate)
+		return bh;
+	ll_rw_block(READ,bh);
+	last = block | ((1<<sb->s_log_zone_size)-1);
+	while (++block <= last) {
+		tmp = getblk(dev,block);
+		if (!tmp->b_uptodate)
+			ll_rw_block(READA,tmp);
+		tmp->b_count--;
+	}
+	wait_on_buffer(bh);
+	if (bh->b_uptodate)
+		return bh;
+	brelse(bh);
+	return (NULL);
+}
+
 //缓冲区初始化函数
 //参数buffer_end是缓冲区内存末端，对于具有16MB内存的系统，缓冲区末端被设置为4MB
 //从缓冲区开始位置start_buffer处和缓冲区末端buffer_end处分别同时设置缓冲块头结构和
@@ -13,22 +13,25 @@
 #include <asm/segment.h>
 #include <asm/io.h>
 
-extern int tty_read(unsigned minor,char * buf,int count);
-extern int tty_write(unsigned minor,char * buf,int count);
+extern int tty_read(unsigned minor,char * buf,int count,unsigned short flags);
+extern int tty_write(unsigned minor,char * buf,int count,unsigned short flags);
 
-typedef (*crw_ptr)(int rw,unsigned minor,char * buf,int count,off_t * pos);
+typedef (*crw_ptr)(int rw,unsigned minor,char * buf,int count,off_t * pos,
+	unsigned short flags);
 
-static int rw_ttyx(int rw,unsigned minor,char * buf,int count,off_t * pos)
+static int rw_ttyx(int rw,unsigned minor,char * buf,int count,off_t * pos,
+	unsigned short flags)
 {
-	return ((rw==READ)?tty_read(minor,buf,count):
-		tty_write(minor,buf,count));
+	return ((rw==READ)?tty_read(minor,buf,count,flags):
+		tty_write(minor,buf,count,flags));
 }
 
-static int rw_tty(int rw,unsigned minor,char * buf,int count, off_t * pos)
+static int rw_tty(int rw,unsigned minor,char * buf,int count, off_t * pos,
+	unsigned short flags)
 {
 	if (current->tty<0)
 		return -EPERM;
-	return rw_ttyx(rw,current->tty,buf,count,pos);
+	return rw_ttyx(rw,current->tty,buf,count,pos,flags);
 }
 
 static int rw_ram(int rw,char * buf, int count, off_t *pos)
@@ -62,7 +65,8 @@ static int rw_port(int rw,char * buf, int count, off_t * pos)
 	return i;
 }
 
-static int rw_memory(int rw, unsigned minor, char * buf, int count, off_t * pos)
+static int rw_memory(int rw, unsigned minor, char * buf, int count, off_t * pos,
+	unsigned short flags)
 {
 	switch(minor) {
 		case 0:
@@ -92,7 +96,8 @@ static crw_ptr crw_table[]={
 	NULL,		/* /dev/lp */
 	NULL};		/* unnamed pipes */
 
-int rw_char(int rw,int dev, char * buf, int count, off_t * pos)
+int rw_char(int rw,int dev, char * buf, int count, off_t * pos,
+	unsigned short flags)
 {
 	crw_ptr call_addr;
 
@@ -100,5 +105,5 @@ int rw_char(int rw,int dev, char * buf, int count, off_t * pos)
 		return -ENODEV;
 	if (!(call_addr=crw_table[MAJOR(dev)]))
 		return -ENODEV;
-	return call_addr(rw,MINOR(dev),buf,count,pos);
+	return call_addr(rw,MINOR(dev),buf,count,pos,flags);
 }
@@ -231,7 +231,7 @@ int do_execve(unsigned long * eip,long tmp,char * filename,
 	char ** argv, char ** envp)
 {
 	struct m_inode * inode;						//内存中i节点指针
-	struct buffer_head * bh;					//高速缓存块头指针
+	char * hdr;									//执行文件第1块数据所在的页面
 	struct exec ex;									//执行文件头部数据结构变量
 	unsigned long page[MAX_ARG_PAGES];		//参数和环境串空间页面指针数组
 	int i,argc,envc;
@@ -278,12 +278,13 @@ restart_interp:
 		goto exec_error2;
 	}
 	//程序执行到这里，说明当前进程有运行指定执行文件的权限
-	//首先读取执行文件第1块数据到高速缓冲块中，并复制缓冲块数据到ex中
-	if (!(bh = bread(inode->i_dev,inode->i_zone[0]))) {
-		retval = -EACCES;
+	//首先用文件系统的readpage操作读取执行文件第1页数据，并复制其中的执行头到ex中
+	if (!(hdr = (char *) get_free_page())) {
+		retval = -ENOMEM;
 		goto exec_error2;
 	}
-	ex = *((struct exec *) bh->b_data);	/* read exec-header */
+	inode->i_op->readpage(inode,0,(unsigned long) hdr);
+	ex = *((struct exec *) hdr);	/* read exec-header */
 	//如果执行文件开始的两个字节是字符'#!'，则说明执行文件是一个脚本文本文件
 	//如果想运行脚本文件，我们就需要执行脚本文件的解释程序(如shell程序)
 	//通常脚本文件的第一行文本为"#!/bin/bash"，它指明了运行脚本文件所需要的解释程序
@@ -292,7 +293,7 @@ restart_interp:
 	//在这之前我们当然需要先把函数指定的原有命令行参数和环境字符串当到128KB空间中，
 	//而这里建立起来的命令行参数则放到它们前面位置处(因为是逆向放置)，最后让内核执行脚本文件的解释程序
 	//下面就是在设置好解释程序的脚本文件名等参数后，取出解释沉痼的i节点并跳转到restart_interp处去执行解释程序
-	if ((bh->b_data[0] == '#') && (bh->b_data[1] == '!') && (!sh_bang)) {
+	if ((hdr[0] == '#') && (hdr[1] == '!') && (!sh_bang)) {
 		/*
 		 * This section does the #! interpretation.
 		 * Sorta complicated, but hopefully it will work.  -TYT
@@ -301,8 +302,8 @@ restart_interp:
 		char buf[1023], *cp, *interp, *i_name, *i_arg;
 		unsigned long old_fs;
 
-		strncpy(buf, bh->b_data+2, 1022);
-		brelse(bh);
+		strncpy(buf, hdr+2, 1022);
+		free_page((unsigned long) hdr);
 		iput(inode);
 		buf[1022] = '\0';
 		if (cp = strchr(buf, '\n')) {
@@ -364,9 +365,9 @@ restart_interp:
 		set_fs(old_fs);
 		goto restart_interp;
 	}
-	//此时缓冲块中的执行文件头结构数据已经复制到了ex中
-	//于是先释放该缓冲块，并开始对ex中的执行头信息进行判断处理
-	brelse(bh);
+	//此时执行文件头结构数据已经复制到了ex中
+	//于是先释放该页面，并开始对ex中的执行头信息进行判断处理
+	free_page((unsigned long) hdr);
 	//对于下列情况将不执行程序：
 	//执行文件不是需求页可执行文件(ZMAGIC)；代码和数据重定位部分长度不等于0；
 	//(代码段+数据段+堆)长度超过50MB；执行文件长度小于(代码段+数据段+符号表长度+执行头部分)长度的总和
@@ -413,11 +414,12 @@ restart_interp:
 	for (i=0 ; i<32 ; i++)
 		current->sigaction[i].sa_handler = NULL;
 	//再根据设定的执行时关闭文件句柄(close_on_exec)位图标志，关闭指定的打开文件并复位该标志
-	for (i=0 ; i<NR_OPEN ; i++)
-		if ((current->close_on_exec>>i)&1)
+	for (i=0 ; i<current->max_fds ; i++)
+		if (FD_CLOEXEC_ISSET(i))
 			sys_close(i);
-	current->close_on_exec = 0;
-	//然后根据当前进程指定的基地址和限长，释放原来程序的代码段和数据段所对应的内存页表指定的物理内存页面及页表本身
+	//然后解除原来程序的文件映射，并根据当前进程指定的基地址和限长，
+	//释放原来程序的代码段和数据段所对应的内存页表指定的物理内存页面及页表本身
+	exit_mmap();
 	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
 	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
 	//如果"上次任务使用了协处理器"指向的是当前进程，则将其置空，并复位使用了协处理器标志
@@ -438,6 +440,8 @@ restart_interp:
 	current->start_stack = p & 0xfffff000;
 	current->euid = e_uid;
 	current->egid = e_gid;
+	//预先装入代码开头的几页，省去程序启动时逐页的缺页异常
+	prefault_text();
 	//如果执行文件代码加数据长度末端不在页面边界上，则把最后不到1页长度的内存空间初始化为0
 	i = ex.a_text+ex.a_data;
 	while (i&0xfff)
@@ -20,27 +20,23 @@ extern int sys_close(int fd);
 //返回新文件句柄或出错码
 static int dupfd(unsigned int fd, unsigned int arg)
 {
+	int newfd;
+
 	//文件句柄就是进程文件结构指针数组索引号
 	//首先检查函数参数的有效性
-	if (fd >= NR_OPEN || !current->filp[fd])
+	if (fd >= current->max_fds || !current->filp[fd])
 		return -EBADF;
 	if (arg >= NR_OPEN)
 		return -EINVAL;
-	//然后在当前进程的文件结构指针数组中寻找索引号等于或大于arg，但还没有使用的项
-	while (arg < NR_OPEN)
-		if (current->filp[arg])
-			arg++;
-		else
-			break;
-	if (arg >= NR_OPEN)
-		return -EMFILE;
-	//针对找到的空闲项(句柄)，在执行时关闭标志位图close_on_exec中复位该句柄位
+	//然后寻找索引号等于或大于arg，但还没有使用的项，必要时扩展句柄表
+	//找到的句柄在执行时关闭标志位图close_on_exec中的位已被复位
 	//即在运行exec()类函数时，不会关闭用dup()创建的句柄
-	current->close_on_exec &= ~(1<<arg);
+	if ((newfd = get_unused_fd(arg)) < 0)
+		return newfd;
 	//令该文件结构指针等于原句柄fd的指针，并将文件引用计数增1
-	(current->filp[arg] = current->filp[fd])->f_count++;
-	//最后返回新的文件句柄arg
-	return arg;
+	(current->filp[newfd] = current->filp[fd])->f_count++;
+	//最后返回新的文件句柄
+	return newfd;
 }
 
 int sys_dup2(unsigned int oldfd, unsigned int newfd)
@@ -61,28 +57,40 @@ int sys_dup(unsigned int fildes)
 int sys_fcntl(unsigned int fd, unsigned int cmd, unsigned long arg)
 {	
 	struct file * filp;
+	int i;
 
-	if (fd >= NR_OPEN || !(filp = current->filp[fd]))
+	if (fd >= current->max_fds || !(filp = current->filp[fd]))
 		return -EBADF;
 	switch (cmd) {
 		case F_DUPFD:
 			return dupfd(fd,arg);
 		case F_GETFD:
-			return (current->close_on_exec>>fd)&1;
+			return FD_CLOEXEC_ISSET(fd);
 		case F_SETFD:
 			if (arg&1)
-				current->close_on_exec |= (1<<fd);
+				FD_CLOEXEC_SET(fd);
 			else
-				current->close_on_exec &= ~(1<<fd);
+				FD_CLOEXEC_CLR(fd);
 			return 0;
 		case F_GETFL:
 			return filp->f_flags;
 		case F_SETFL:
-			filp->f_flags &= ~(O_APPEND | O_NONBLOCK);
-			filp->f_flags |= arg & (O_APPEND | O_NONBLOCK);
+			filp->f_flags &= ~(O_APPEND | O_NONBLOCK | O_DIRECT);
+			filp->f_flags |= arg & (O_APPEND | O_NONBLOCK | O_DIRECT);
 			return 0;
 		case F_GETLK:	case F_SETLK:	case F_SETLKW:
 			return -1;
+		//管道容量：参数是字节数，向上取整为2的幂个页面
+		case F_GETPIPE_SZ:
+			if (!filp->f_inode->i_pipe)
+				return -EINVAL;
+			return PIPE_BUF_SIZE(*filp->f_inode);
+		case F_SETPIPE_SZ:
+			if (!filp->f_inode->i_pipe)
+				return -EINVAL;
+			for (i=1 ; i<PIPE_MAX_PAGES && i*PAGE_SIZE<arg ; i <<= 1)
+				;
+			return pipe_set_pages(filp->f_inode,i);
 		default:
 			return -1;
 	}
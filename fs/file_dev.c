@@ -6,6 +6,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
@@ -14,6 +16,45 @@
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
+/*
+ * O_DIRECT: the whole blocks of the file from pos on (at most count
+ * bytes) go straight between the disk and the user buffer, DIRECT_BATCH
+ * at a time. A read stops at the last whole block inside the file, a
+ * write allocates the blocks it needs. Only for user-space buffers
+ * (fs = 0x17). Returns the bytes done.
+ */
+static int file_direct(int rw, struct m_inode * inode, off_t pos,
+	char * buf, int count)
+{
+	int nr[DIRECT_BATCH];
+	int i,n,block,chars,done = 0;
+
+	//延迟分配的数据还在缓冲区中，先给它们分配磁盘块
+	if (inode->i_ndelay)
+		alloc_delayed(inode);
+	if (rw == READ)
+		count = MIN(count,(int) (inode->i_size - pos));
+	block = pos / BLOCK_SIZE;
+	while ((n = MIN(count/BLOCK_SIZE,DIRECT_BATCH)) > 0) {
+		for (i=0 ; i<n ; i++)
+			if (rw == READ)
+				nr[i] = bmap(inode,block+i);
+			else if (!(nr[i] = create_block(inode,block+i)))
+				break;
+		if (!(n = i))
+			break;
+		if ((chars = direct_rw(rw,inode->i_dev,nr,n,buf)) <= 0)
+			break;
+		block += chars/BLOCK_SIZE;
+		buf += chars;
+		done += chars;
+		count -= chars;
+		if (chars < n*BLOCK_SIZE)
+			break;
+	}
+	return done;
+}
+
 //文件读函数-根据i节点和文件结构读取文件中数据
 int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 {
@@ -23,13 +64,26 @@ int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 	//首先判断参数的有效性
 	if ((left=count)<=0)
 		return 0;
+	//O_DIRECT且位置和用户缓冲区都按块对齐时，整块部分直接读，零头仍经过高速缓冲
+	//sendfile()等内核调用者(fs不是0x17)的缓冲区不在用户空间，不能直接传输
+	if ((filp->f_flags & O_DIRECT) && get_fs() == 0x17 &&
+	    S_ISREG(inode->i_mode) &&
+	    !(filp->f_pos % BLOCK_SIZE) && !((unsigned long) buf % BLOCK_SIZE)) {
+		chars = file_direct(READ,inode,filp->f_pos,buf,left);
+		filp->f_pos += chars;
+		buf += chars;
+		left -= chars;
+	}
 	//若读取的字节数不为0就循环执行下面操作，直到数据全部读出或遇到问题
 	while (left) {
 		//根据i节点和文件表结构信息，
 		//并利用bmap()得到包含文件当前读写位置的数据块在设备上对应的逻辑块号nr
-		if (nr = bmap(inode,(filp->f_pos)/BLOCK_SIZE)) {
-			//从i节点指定设备上读取该逻辑块
-			if (!(bh=bread(inode->i_dev,nr)))
+		//还未分配磁盘块的延迟写数据在缓冲区中，要先找
+		if (bh = get_delayed(inode,(filp->f_pos)/BLOCK_SIZE,0))
+			;
+		else if (nr = bmap(inode,(filp->f_pos)/BLOCK_SIZE)) {
+			//从i节点指定设备上读取该盘块(同时预读它所在逻辑块的其余盘块)
+			if (!(bh=bread_zone(inode->i_dev,nr)))
 				break;
 		} else
 			bh = NULL;
@@ -41,15 +95,14 @@ int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 		left -= chars;
 		//若从设备上读到了数据
 		if (bh) {
-			//p指向缓冲块中开始读取数据的位置，并且复制chars字节到用户缓冲区buf中
-			char * p = nr + bh->b_data;
-			while (chars-->0)
-				put_fs_byte(*(p++),buf++);
+			//复制缓冲块中从偏移nr开始的chars字节到用户缓冲区buf中
+			memcpy_tofs(buf,nr + bh->b_data,chars);
+			buf += chars;
 			brelse(bh);
 		//否则往用户缓冲区中填入chars个0值字节
 		} else {
-			while (chars-->0)
-				put_fs_byte(0,buf++);
+			clear_fs(buf,chars);
+			buf += chars;
 		}
 	}
 	//修改i节点的访问时间为当前时间
@@ -79,17 +132,39 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 		pos = inode->i_size;
 	else
 		pos = filp->f_pos;
+	//O_DIRECT的整块部分直接写到磁盘上
+	if ((filp->f_flags & O_DIRECT) && get_fs() == 0x17 &&
+	    !(pos % BLOCK_SIZE) &&
+	    !((unsigned long) buf % BLOCK_SIZE)) {
+		i = file_direct(WRITE,inode,pos,buf,count);
+		buf += i;
+		pos += i;
+		if (pos > inode->i_size) {
+			inode->i_size = pos;
+			inode->i_dirt = 1;
+			inode->i_dsync = 1;
+		}
+	}
 	// 然后在已写入字节数i(刚开始为0)小于指定写入字节数count时，循环执行以下操作
 	while (i<count) {
-		//先取文件数据块号(pos/BLOCK_SIZE)在设备上对应的逻辑块号block，如果不存在就创建一块
-		if (!(block = create_block(inode,pos/BLOCK_SIZE)))
-			break;
-		//根据该逻辑块号读取设备上的相应逻辑块
-		if (!(bh=bread(inode->i_dev,block)))
-			break;
-		//求出文件当前读写指针在该数据块中的偏移值c,并将指针p指向缓冲块中开始写入数据的位置
 		c = pos % BLOCK_SIZE;
+		//先找该文件数据块的延迟写缓冲块，再取其在设备上对应的逻辑块号block
+		//如果还没有对应的逻辑块，则不立即分配，而是建立一个延迟写缓冲块，等回写时再统一分配
+		if (!(bh = get_delayed(inode,pos/BLOCK_SIZE,0))) {
+			if (block = bmap(inode,pos/BLOCK_SIZE)) {
+				//整块覆盖时不必先从设备读入原有数据
+				if (!c && count-i >= BLOCK_SIZE)
+					bh = getblk(inode->i_dev,block);
+				else
+					bh = bread(inode->i_dev,block);
+			} else
+				bh = get_delayed(inode,pos/BLOCK_SIZE,1);
+			if (!bh)
+				break;
+		}
+		//将指针p指向缓冲块中开始写入数据的位置
 		p = c + bh->b_data;
+		bh->b_uptodate = 1;
 		bh->b_dirt = 1;
 		c = BLOCK_SIZE-c;
 		if (c > count-i) c = count-i;
@@ -97,11 +172,12 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 		if (pos > inode->i_size) {
 			inode->i_size = pos;
 			inode->i_dirt = 1;
+			inode->i_dsync = 1;
 		}
 		i += c;
 		//从用户缓冲区buf中复制c个字节到高速缓冲块中p指向的开始位置处
-		while (c-->0)
-			*(p++) = get_fs_byte(buf++);
+		memcpy_fromfs(p,buf,c);
+		buf += c;
 		brelse(bh);
 	}
 	inode->i_mtime = CURRENT_TIME;
@@ -111,3 +187,69 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 	}
 	return (i?i:-1);
 }
+
+//读入文件中从off开始的一页(4个数据块)，文件末尾之后的块不读
+int minix_readpage(struct m_inode * inode, unsigned long off,
+	unsigned long page)
+{
+	int nr[4];
+	int block,i;
+
+	//延迟分配的数据还不在磁盘块上，bmap()看不到，先给它们分配块
+	if (inode->i_ndelay)
+		alloc_delayed(inode);
+	block = off/BLOCK_SIZE;
+	for (i=0 ; i<4 ; block++,i++)
+		nr[i] = (block*BLOCK_SIZE < inode->i_size) ? bmap(inode,block) : 0;
+	bread_page(page,inode->i_dev,nr);
+	return 0;
+}
+
+/*
+ * Start reading the blocks of the pages pages from off on into the
+ * buffer cache, without waiting for them: a later readpage() of those
+ * pages finds them there. Blocks past the end of the file, and delayed
+ * blocks that have no disk block yet, are skipped.
+ */
+void minix_readahead(struct m_inode * inode, unsigned long off, int pages)
+{
+	struct buffer_head * bh;
+	int block,end,nr;
+
+	block = off/BLOCK_SIZE;
+	end = block + 4*pages;
+	for ( ; block < end && block*BLOCK_SIZE < inode->i_size ; block++)
+		if ((nr = bmap(inode,block)) && (bh = getblk(inode->i_dev,nr))) {
+			if (!bh->b_uptodate)
+				ll_rw_block(READA,bh);
+			//只是预读，不等它读完就放掉
+			bh->b_count--;
+		}
+}
+
+/*
+ * Write a dirty page of a shared mapping back to the file. Only blocks
+ * inside the current file size are written: a mapping never extends
+ * the file.
+ */
+void minix_writepage(struct m_inode * inode, unsigned long off,
+	unsigned long page)
+{
+	struct buffer_head * bh;
+	int i,nr;
+
+	if (inode->i_ndelay)
+		alloc_delayed(inode);
+	for (i=0 ; i<4 ; i++,off += BLOCK_SIZE,page += BLOCK_SIZE) {
+		if (off >= inode->i_size)
+			break;
+		if (!(nr = create_block(inode,off/BLOCK_SIZE)))
+			break;
+		if (!(bh = getblk(inode->i_dev,nr)))
+			break;
+		memcpy(bh->b_data,(char *) page,BLOCK_SIZE);
+		bh->b_uptodate = 1;
+		bh->b_dirt = 1;
+		brelse(bh);
+	}
+}
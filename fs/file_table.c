@@ -4,6 +4,139 @@
  *  (C) 1991  Linus Torvalds
  */
 
-#include <linux/fs.h>
+/*
+ * File structures are no longer a fixed table: they are carved out of
+ * free pages when needed and kept on a free list, so getting one never
+ * means searching. At most NR_FILE of them are ever made.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+
+#define FILES_PER_PAGE (PAGE_SIZE/sizeof(struct file))
+
+static struct file * free_filps = NULL;	//空闲文件结构链表
+static int nr_files = 0;				//已分配的文件结构总数
+
+//取一页内存，把它分成文件结构放入空闲链表
+static void grow_files(void)
+{
+	struct file * f;
+	int i;
+
+	if (nr_files + FILES_PER_PAGE > NR_FILE)
+		return;
+	if (!(f = (struct file *) get_free_page()))
+		return;
+	nr_files += FILES_PER_PAGE;
+	for (i = 0 ; i < FILES_PER_PAGE ; i++,f++) {
+		f->f_next = free_filps;
+		free_filps = f;
+	}
+}
+
+//取一个空闲文件结构，引用计数置为1。没有则返回NULL
+struct file * get_empty_filp(void)
+{
+	struct file * f;
+
+	if (!free_filps)
+		grow_files();
+	if (!(f = free_filps))
+		return NULL;
+	free_filps = f->f_next;
+	f->f_next = NULL;
+	f->f_count = 1;
+	return f;
+}
+
+//释放文件结构(引用计数已经或应该为0)
+void put_filp(struct file * f)
+{
+	f->f_count = 0;
+	f->f_inode = NULL;
+	f->f_next = free_filps;
+	free_filps = f;
+}
+
+/*
+ * Move the descriptors of the current process out of its task_struct
+ * into a page big enough for NR_OPEN of them.
+ */
+static int expand_files(void)
+{
+	struct fd_table * t;
+
+	if (current->max_fds >= NR_OPEN)
+		return -EMFILE;
+	if (!(t = (struct fd_table *) get_free_page()))
+		return -ENOMEM;
+	memcpy(t->filp,current->filp,current->max_fds*sizeof(struct file *));
+	t->close_on_exec[0] = *current->close_on_exec;
+	current->filp = t->filp;
+	current->close_on_exec = t->close_on_exec;
+	current->max_fds = NR_OPEN;
+	return 0;
+}
+
+/*
+ * Find the lowest unused descriptor not below fd, growing the table if
+ * it is full. Descriptors below next_fd are known to be in use, so the
+ * search normally starts right at the free one.
+ */
+int get_unused_fd(int fd)
+{
+	int i, lowest;
+
+	if (fd < 0 || fd >= NR_OPEN)
+		return -EINVAL;
+	if (lowest = (fd <= current->next_fd))
+		fd = current->next_fd;
+	for (;;) {
+		for ( ; fd < current->max_fds ; fd++)
+			if (!current->filp[fd])
+				break;
+		if (fd < current->max_fds)
+			break;
+		if (i = expand_files())
+			return i;
+	}
+	//从next_fd开始找到的句柄就是最小的空闲句柄
+	if (lowest)
+		current->next_fd = fd;
+	FD_CLOEXEC_CLR(fd);
+	return fd;
+}
+
+//fork()时为子进程复制文件句柄表。子进程的文件引用计数由调用者增加
+int copy_files(struct task_struct * p)
+{
+	struct fd_table * t;
+
+	if (current->filp == current->init_filp) {
+		p->filp = p->init_filp;
+		p->close_on_exec = &p->init_close_on_exec;
+		return 0;
+	}
+	if (!(t = (struct fd_table *) get_free_page()))
+		return -ENOMEM;
+	*t = *(struct fd_table *) current->filp;
+	p->filp = t->filp;
+	p->close_on_exec = t->close_on_exec;
+	return 0;
+}
 
-struct file file_table[NR_FILE];        //文件表数组(64项)
+//进程退出时在关闭所有文件之后调用，释放扩展出来的句柄表页面
+void exit_files(void)
+{
+	if (current->filp != current->init_filp)
+		free_page((long) current->filp);
+	current->filp = current->init_filp;
+	current->close_on_exec = &current->init_close_on_exec;
+	current->max_fds = NR_OPEN_DEFAULT;
+	current->next_fd = 0;
+}
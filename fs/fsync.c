@@ -0,0 +1,125 @@
+/*
+ *  linux/fs/fsync.c
+ */
+
+/*
+ * fsync() and fdatasync(). Instead of writing out every dirty buffer in
+ * the system as sync() does, only the blocks of one file are written:
+ * its data blocks and indirect blocks, found by walking the zone tree of
+ * the inode, and then the block holding the inode itself. The caller
+ * waits for these writes only.
+ */
+
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+
+//写出(wait=0)或等待写完(wait=1)高速缓冲中的盘块block，返回非0表示写盘出错
+static int sync_block(int dev, int block, int wait)
+{
+	struct buffer_head * bh;
+	int err = 0;
+
+	//不在高速缓冲中的块不需要写。get_hash_table()会等待缓冲块解锁
+	if (!(bh = get_hash_table(dev,block)))
+		return 0;
+	if (wait)
+		err = !bh->b_uptodate;
+	else if (bh->b_dirt)
+		ll_rw_block(WRITE,bh);
+	brelse(bh);
+	return err;
+}
+
+//同步逻辑块zone。depth为0时zone是数据逻辑块，否则是depth级间接块
+static int sync_zone(struct super_block * sb, int dev, unsigned long zone,
+	int depth, int wait)
+{
+	struct buffer_head * bh;
+	unsigned long nr;
+	int i, err = 0;
+
+	if (!zone)
+		return 0;
+	if (!depth) {
+		for (i=0 ; i < (1<<sb->s_log_zone_size) ; i++)
+			err |= sync_block(dev,(zone<<sb->s_log_zone_size)+i,wait);
+		return err;
+	}
+	if (!(bh = bread(dev,zone<<sb->s_log_zone_size)))
+		return 1;
+	for (i=0 ; i<ZONES_PER_BLOCK(sb) ; i++)
+		if (nr = GET_ZONE(sb,bh->b_data,i))
+			err |= sync_zone(sb,dev,nr,depth-1,wait);
+	brelse(bh);
+	return err | sync_block(dev,zone<<sb->s_log_zone_size,wait);
+}
+
+static int sync_file_zones(struct m_inode * inode, int wait)
+{
+	struct super_block * sb;
+	int i, err = 0;
+
+	if (!(sb = get_super(inode->i_dev)))
+		return 1;
+	for (i=0 ; i<7 ; i++)
+		err |= sync_zone(sb,inode->i_dev,inode->i_zone[i],0,wait);
+	for (i=7 ; i<10 ; i++)
+		err |= sync_zone(sb,inode->i_dev,inode->i_zone[i],i-6,wait);
+	return err;
+}
+
+/*
+ * The fsync operation of minix files. datasync: skip the inode unless
+ * something needed to read the data back (the size or the block map,
+ * see i_dsync) has changed.
+ */
+int minix_fsync(struct m_inode * inode, int datasync)
+{
+	int err;
+
+	//延迟分配的数据先分配磁盘块
+	if (inode->i_ndelay)
+		alloc_delayed(inode);
+	//先为所有脏块发出写请求，再逐一等待，这样各块的写操作可以在队列中排序合并
+	sync_file_zones(inode,0);
+	err = sync_file_zones(inode,1);
+	if (!datasync || inode->i_dsync)
+		err |= sync_inode(inode);
+	return err ? -EIO : 0;
+}
+
+static int do_fsync(unsigned int fd, int datasync)
+{
+	struct file * file;
+	struct m_inode * inode;
+
+	if (fd >= current->max_fds || !(file = current->filp[fd]))
+		return -EBADF;
+	inode = file->f_inode;
+	if (S_ISBLK(inode->i_mode)) {
+		sync_dev(inode->i_zone[0]);
+		return 0;
+	}
+	if (!S_ISREG(inode->i_mode) && !S_ISDIR(inode->i_mode))
+		return -EINVAL;
+	//共享映射中改过的页先写回文件
+	if (S_ISREG(inode->i_mode))
+		sync_mmap(inode);
+	//没有fsync操作的文件系统(如tmpfs)和只读文件系统没有要写回的东西
+	if (!inode->i_op->fsync || IS_RDONLY(inode))
+		return 0;
+	return inode->i_op->fsync(inode,datasync);
+}
+
+int sys_fsync(unsigned int fd)
+{
+	return do_fsync(fd,0);
+}
+
+int sys_fdatasync(unsigned int fd)
+{
+	return do_fsync(fd,1);
+}
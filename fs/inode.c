@@ -46,6 +46,7 @@ void invalidate_inodes(int dev)
 	int i;
 	struct m_inode * inode;
 
+	invalidate_pages(dev,0);
 	inode = 0+inode_table;
 	for(i=0 ; i<NR_INODE ; i++,inode++) {
 		wait_on_inode(inode);
@@ -64,93 +65,155 @@ void sync_inodes(void)
 
 	inode = 0+inode_table;
 	for(i=0 ; i<NR_INODE ; i++,inode++) {
-		wait_on_inode(inode);
+		//上锁的i节点正由持有者读写，不等它：从getblk()->sync_dev()进来时持有者可能就是自己
+		if (inode->i_lock)
+			continue;
+		if (inode->i_ndelay)
+			alloc_delayed(inode);
 		if (inode->i_dirt && !inode->i_pipe)
 			write_inode(inode);
 	}
 }
 
+/*
+ * Each inode remembers a few runs of consecutive zones decoded from its
+ * indirect blocks, so that walking a big file doesn't have to bread()
+ * the indirect (and double indirect) block again for every block.
+ * Only existing mappings are cached, so filling a hole can't make an
+ * entry stale - only truncate() has to throw them away. Runs map zones
+ * of the file to zones of the device, not blocks.
+ */
+static int map_lookup(struct m_inode * inode,int block)
+{
+	struct map_run * r = inode->i_map;
+	int i;
+
+	for (i=0 ; i<NR_MAP_RUNS ; i++,r++)
+		if (block >= r->block && block < r->block+r->len)
+			return r->zone + (block - r->block);
+	return 0;
+}
+
+//文件中的逻辑块block对应间接块bh中的第n项，从该项到间接块末尾查找连续的逻辑块
+static void map_remember(struct m_inode * inode,struct super_block * sb,
+	int block,struct buffer_head * bh,int n)
+{
+	struct map_run * r;
+	unsigned long zone;
+	int len;
+
+	zone = GET_ZONE(sb,bh->b_data,n);
+	for (len=1 ; n+len<ZONES_PER_BLOCK(sb) &&
+	     GET_ZONE(sb,bh->b_data,n+len)==zone+len ; len++)
+		/* nothing */ ;
+	r = inode->i_map + inode->i_mapnext;
+	inode->i_mapnext = (inode->i_mapnext+1) % NR_MAP_RUNS;
+	r->block = block;
+	r->zone = zone;
+	r->len = len;
+}
+
+/*
+ * create==1 allocates missing data blocks with new_block(). Any larger
+ * value is a zone the caller has already reserved (see alloc_delayed())
+ * and is entered as the data block as-is. Indirect blocks always come
+ * from new_block(), as they must be cleared. Inside alloc_delayed()
+ * new_block() may use the zones reserved for delayed data.
+ */
+#define NEW_BLOCK(inode) \
+new_block((inode)->i_dev,(inode)->i_dalloc == current)
+#define NEW_ZONE(inode,create) \
+((create)>1?(create):NEW_BLOCK(inode))
+
 //文件数据块映射到盘块的处理函数
-//参数：inode-文件的i节点指针 block-文件中的数据块号 create-创建块标志
-//该函数把指定的文件数据块block对应到设备上逻辑块并返回逻辑块号
-//如果创建标志置位，则在设备上对应逻辑块不存在时就申请新磁盘块，返回文件数据块block对应在设备上的逻辑块号(盘块号)
+//参数：inode-文件的i节点指针 block-文件中的数据块号 create-创建块标志(或预留的逻辑块号)
+//该函数把指定的文件数据块block对应到设备上逻辑块并返回盘块号
+//如果创建标志置位，则在设备上对应逻辑块不存在时就申请新逻辑块，返回文件数据块block对应在设备上的盘块号
+//v1文件系统每个间接块有512项，最多二次间接；v2每块256项，i_zone[9]是三次间接块
+//一个逻辑块(zone)含有2^s_log_zone_size个盘块，i节点和间接块中记录的都是逻辑块号，
+//间接块只使用其逻辑块的第一个盘块
 static int _bmap(struct m_inode * inode,int block,int create)
 {
+	struct super_block * sb;
 	struct buffer_head * bh;
-	int i;
+	int i,n,depth,shift,left,log,off;
 
 	//首先判断参数文件数据块号block的有效性
 	//如果块号小于0则停机
 	if (block<0)
 		panic("_bmap: block<0");
-	//如果块号大于直接块数+间接块数+二次间接块数，超出文件系统表示范围则停机
-	if (block >= 7+512+512*512)
-		panic("_bmap: block>big");
-	//如果块号小于7则使用直接块表示
+	if (!(sb = get_super(inode->i_dev)))
+		panic("_bmap: no super-block");
+	//把文件数据块号换算成文件中的逻辑块号和块在逻辑块内的偏移
+	log = sb->s_log_zone_size;
+	off = block & ((1<<log)-1);
+	block >>= log;
+	//如果逻辑块号小于7则使用直接块表示
 	if (block<7) {
 		//如果创建标志置位，并且i节点中对应该块的逻辑块字段为0,
-		//则向相应设备申请一块磁盘块，并将盘上逻辑块号填入逻辑块字段中
+		//则向相应设备申请一个逻辑块，并将其逻辑块号填入逻辑块字段中
 		if (create && !inode->i_zone[block])
-			if (inode->i_zone[block]=new_block(inode->i_dev)) {
+			if (inode->i_zone[block]=NEW_ZONE(inode,create)) {
 				inode->i_ctime=CURRENT_TIME;
 				inode->i_dirt=1;
+				inode->i_dsync=1;
 			}
-		//返回逻辑块号
-		return inode->i_zone[block];
-	}
-	//如果该块号>=7且小于7+512，则说明使用的是一次间接块
-	block -= 7;
-	if (block<512) {
-		if (create && !inode->i_zone[7])
-			if (inode->i_zone[7]=new_block(inode->i_dev)) {
-				inode->i_dirt=1;
-				inode->i_ctime=CURRENT_TIME;
-			}
-		if (!inode->i_zone[7])
+		//返回盘块号
+		if (!(i = inode->i_zone[block]))
 			return 0;
-		//现在读取设备上该i节点的一次间接块，并取该间接块上的第block项中的逻辑块号(盘块号)i
-		if (!(bh = bread(inode->i_dev,inode->i_zone[7])))
-			return 0;
-		i = ((unsigned short *) (bh->b_data))[block];
-		if (create && !i)
-			if (i=new_block(inode->i_dev)) {
-				((unsigned short *) (bh->b_data))[block]=i;
-				bh->b_dirt=1;
-			}
-		brelse(bh);
-		//返回磁盘上新申请或原有的对应block的逻辑块号
-		return i;
+		return (i<<log)+off;
+	}
+	//间接块中的映射先查i节点中缓存的连续块区段
+	if (i = map_lookup(inode,block))
+		return (i<<log)+off;
+	//求出block要经过几级间接块(depth)，以及它在该级所管理的块中的序号left
+	left = block-7;
+	for (depth=1 ; depth <= sb->s_version+1 ; depth++) {
+		if (left < (1 << (ZONE_BITS(sb)*depth)))
+			break;
+		left -= 1 << (ZONE_BITS(sb)*depth);
 	}
-	//若程序运行到此，则表明数据块属于二次间接块
-	block -= 512;
-	if (create && !inode->i_zone[8])
-		if (inode->i_zone[8]=new_block(inode->i_dev)) {
+	//如果块号超出文件系统表示范围则停机
+	if (depth > sb->s_version+1)
+		panic("_bmap: block>big");
+	//i_zone[6+depth]是这一级的顶层间接块
+	if (create && !inode->i_zone[6+depth])
+		if (inode->i_zone[6+depth]=NEW_BLOCK(inode)) {
 			inode->i_dirt=1;
+			inode->i_dsync=1;
 			inode->i_ctime=CURRENT_TIME;
 		}
-	if (!inode->i_zone[8])
-		return 0;
-	if (!(bh=bread(inode->i_dev,inode->i_zone[8])))
+	if (!(i = inode->i_zone[6+depth]))
 		return 0;
-	i = ((unsigned short *)bh->b_data)[block>>9];
+	//逐级读取间接块，取出下一级的逻辑块号，直到最底层的数据逻辑块号
+	for (shift = ZONE_BITS(sb)*(depth-1) ; ; shift -= ZONE_BITS(sb)) {
+		if (!(bh = bread(inode->i_dev,i<<log)))
+			return 0;
+		n = (left >> shift) & (ZONES_PER_BLOCK(sb)-1);
+		i = GET_ZONE(sb,bh->b_data,n);
+		if (!shift)
+			break;
+		if (create && !i)
+			if (i=NEW_BLOCK(inode)) {
+				SET_ZONE(sb,bh->b_data,n,i);
+				journal_dirty(bh);
+			}
+		brelse(bh);
+		if (!i)
+			return 0;
+	}
+	if (i)
+		map_remember(inode,sb,block,bh,n);
 	if (create && !i)
-		if (i=new_block(inode->i_dev)) {
-			((unsigned short *) (bh->b_data))[block>>9]=i;
-			bh->b_dirt=1;
+		if (i=NEW_ZONE(inode,create)) {
+			SET_ZONE(sb,bh->b_data,n,i);
+			journal_dirty(bh);
 		}
 	brelse(bh);
+	//返回磁盘上新申请或原有的对应block的盘块号
 	if (!i)
 		return 0;
-	if (!(bh=bread(inode->i_dev,i)))
-		return 0;
-	i = ((unsigned short *)bh->b_data)[block&511];
-	if (create && !i)
-		if (i=new_block(inode->i_dev)) {
-			((unsigned short *) (bh->b_data))[block&511]=i;
-			bh->b_dirt=1;
-		}
-	brelse(bh);
-	return i;
+	return (i<<log)+off;
 }
 
 //取文件数据块block在设备上对应的逻辑块号
@@ -167,12 +230,275 @@ int create_block(struct m_inode * inode, int block)
 	return _bmap(inode,block,1);
 }
 
+/*
+ * A delayed block past the direct zones also needs the indirect blocks
+ * on its path once alloc_delayed() enters it in the block map. They
+ * are reserved along with the block, so a full device makes write()
+ * fail instead of losing data that write() has already taken. One set
+ * (one block per level) is reserved per group of delayed blocks under
+ * the same bottom-level indirect block: a block next to a delayed one
+ * in the same group needs nothing more. Indirect blocks that already
+ * exist are counted too, but only until alloc_delayed() has run.
+ */
+#define IND_GROUP(sb,zone) (((zone)-7) >> ZONE_BITS(sb))
+
+static int indirect_needed(struct m_inode * inode, struct super_block * sb,
+	int block)
+{
+	struct buffer_head * bh;
+	int zone,n,depth,left,i;
+
+	zone = block >> sb->s_log_zone_size;
+	if (zone < 7)
+		return 0;
+	for (i=-1 ; i<=1 ; i += 2) {
+		n = (block+i) >> sb->s_log_zone_size;
+		if (block+i < 0 || n < 7 || IND_GROUP(sb,n) != IND_GROUP(sb,zone))
+			continue;
+		if (bh = get_delayed(inode,block+i,0)) {
+			brelse(bh);
+			return 0;
+		}
+	}
+	//与_bmap()中一样求出间接块的级数
+	left = zone-7;
+	for (depth=1 ; depth < sb->s_version+1 ; depth++) {
+		if (left < (1 << (ZONE_BITS(sb)*depth)))
+			break;
+		left -= 1 << (ZONE_BITS(sb)*depth);
+	}
+	return depth;
+}
+
+//放掉为延迟写块的间接块所作的预留
+static void put_indirect(struct m_inode * inode)
+{
+	struct super_block * sb;
+
+	if ((sb = get_super(inode->i_dev)) && sb->s_zdelay >= inode->i_nindir)
+		sb->s_zdelay -= inode->i_nindir;
+	inode->i_nindir = 0;
+}
+
+//取文件数据块block对应的延迟分配缓冲块
+//create为0时只查找(没有待写数据则返回NULL)，否则在不存在时建立一个清零的缓冲块
+struct buffer_head * get_delayed(struct m_inode * inode,int block,int create)
+{
+	struct buffer_head * bh;
+	struct super_block * sb;
+	int need;
+
+	if (!create) {
+		if (!inode->i_ndelay)
+			return NULL;
+		if (!(bh = get_hash_table(DELAY_DEV(inode),block)))
+			return NULL;
+		//伪设备上只有已修改的缓冲块才含有效数据，其余都是丢弃或分配后残留的
+		if (bh->b_dirt)
+			return bh;
+		brelse(bh);
+		return NULL;
+	}
+	if (!(bh = getblk(DELAY_DEV(inode),block)))
+		return NULL;
+	if (!bh->b_dirt) {
+		//新的延迟写块要在超级块中预留一个空闲块(及其要用的间接块)
+		//设备已满时先释放等待回收的已删除文件，仍不够就立即失败，而不是等到回写时
+		if (!(sb = get_super(inode->i_dev))) {
+			brelse(bh);
+			return NULL;
+		}
+		need = 1 + indirect_needed(inode,sb,block);
+		if (sb->s_zfree < sb->s_zdelay + need)
+			reclaim_inodes(inode->i_dev);
+		if (sb->s_zfree < sb->s_zdelay + need) {
+			brelse(bh);
+			return NULL;
+		}
+		//reclaim_inodes()中可能睡眠，期间别人可能已经建立了这一块
+		if (bh->b_dirt)
+			return bh;
+		sb->s_zdelay += need;
+		inode->i_nindir += need-1;
+		memset(bh->b_data,0,BLOCK_SIZE);
+		bh->b_uptodate = 1;
+		bh->b_dirt = 1;
+		inode->i_ndelay++;
+	}
+	return bh;
+}
+
+//延迟写块数减少n，同时取消超级块中为其所作的预留
+static void put_delayed(struct m_inode * inode,int n)
+{
+	struct super_block * sb;
+
+	inode->i_ndelay -= n;
+	if ((sb = get_super(inode->i_dev)) && sb->s_zdelay >= n)
+		sb->s_zdelay -= n;
+}
+
+//在缓冲区中找出伪设备dev上逻辑块号最小的延迟写缓冲块，没有则返回-1
+static int first_delayed(int dev)
+{
+	struct buffer_head * bh;
+	int i, block = -1;
+
+	bh = start_buffer;
+	for (i=0 ; i<NR_BUFFERS ; i++,bh++)
+		if (bh->b_dev == dev && bh->b_dirt &&
+		    (block < 0 || bh->b_blocknr < block))
+			block = bh->b_blocknr;
+	return block;
+}
+
+/*
+ * alloc_delayed() allocates disk blocks for all the delayed data of an
+ * inode. Runs of consecutive file blocks get one run of consecutive
+ * zones, placed right after the preceding block of the file if that is
+ * free. The buffers then simply move over to the real device, still
+ * dirty - nothing is copied and nothing is read.
+ *
+ * The buffers of a run are moved before any of the run is entered in
+ * the block map: _bmap() may need free buffers for indirect blocks, and
+ * getblk() can then write the moved ones out instead of picking another
+ * delayed buffer and coming back here. A call from inside the
+ * allocation (getblk() -> sync_dev(), or sync_inodes()) returns at once.
+ */
+void alloc_delayed(struct m_inode * inode)
+{
+	struct buffer_head * bh;
+	struct super_block * sb;
+	int dev = DELAY_DEV(inode);
+	int block,first,count,nr,i;
+
+	if (!(sb = get_super(inode->i_dev)))
+		return;
+	if (inode->i_dalloc == current)
+		return;
+	while (inode->i_dalloc)
+		sleep_on(&inode->i_wait);
+	inode->i_dalloc = current;
+	journal_start(inode->i_dev);
+	while (inode->i_ndelay) {
+		if ((block = first_delayed(dev)) < 0) {
+			put_delayed(inode,inode->i_ndelay);
+			break;
+		}
+		//逻辑块含有多个盘块时，由create_block()逐块分配(整个逻辑块一次分配好)
+		if (sb->s_log_zone_size) {
+			bh = get_delayed(inode,block,0);
+			if (!(nr = create_block(inode,block))) {
+				brelse(bh);
+				printk("alloc_delayed: no space on dev %04x\n",
+					inode->i_dev);
+				discard_delayed(inode);
+				break;
+			}
+			remap_buffer(bh,inode->i_dev,nr);
+			put_delayed(inode,1);
+			brelse(bh);
+			continue;
+		}
+		//目标位置是前一块之后，只查i节点和映射缓存：这里读间接块会要空闲缓冲块
+		first = 0;
+		if (block > 0 && block <= 7)
+			first = inode->i_zone[block-1];
+		else if (block > 7)
+			first = map_lookup(inode,block-1);
+		if (first)
+			first++;
+		//统计从block开始连续的延迟写块数
+		for (count=1 ; (bh=get_delayed(inode,block+count,0)) ; count++)
+			brelse(bh);
+		if (!(first = new_zones(inode->i_dev,first,&count))) {
+			printk("alloc_delayed: no space on dev %04x\n",
+				inode->i_dev);
+			discard_delayed(inode);
+			break;
+		}
+		//new_zones()中可能睡眠，期间被截断掉的块及其后的预留块退回
+		for (i=0 ; i<count ; i++) {
+			if (!(bh = get_delayed(inode,block+i,0))) {
+				free_zones(inode->i_dev,first+i,count-i);
+				count = i;
+				break;
+			}
+			remap_buffer(bh,inode->i_dev,first+i);
+			put_delayed(inode,1);
+			brelse(bh);
+		}
+		//再登记到块映射中，所需的间接块已在get_delayed()中预留
+		for (i=0 ; i<count ; i++)
+			if (_bmap(inode,block+i,first+i) != first+i) {
+				printk("alloc_delayed: no space on dev %04x\n",
+					inode->i_dev);
+				free_block(inode->i_dev,first+i);
+			}
+	}
+	if (!inode->i_ndelay)
+		put_indirect(inode);
+	journal_stop(inode->i_dev);
+	inode->i_dalloc = NULL;
+	wake_up(&inode->i_wait);
+}
+
+//丢弃i节点所有延迟写数据(用于截断文件)
+void discard_delayed(struct m_inode * inode)
+{
+	struct buffer_head * bh;
+	int i, dev = DELAY_DEV(inode);
+
+	bh = start_buffer;
+	for (i=0 ; i<NR_BUFFERS ; i++,bh++)
+		if (bh->b_dev == dev)
+			bh->b_dirt = bh->b_uptodate = 0;
+	put_delayed(inode,inode->i_ndelay);
+	put_indirect(inode);
+}
+
+/*
+ * Freeing the blocks of a large file means reading all its indirect
+ * blocks, so iput() doesn't do it for files that have any. The inode
+ * keeps its last reference, is marked i_reclaim, and reclaim_inodes()
+ * frees it later: on sync() (every 30 seconds from update), when the
+ * device runs out of zones or inodes or the inode table is full, and
+ * before an umount. dev 0 means all devices. Returns the number of
+ * inodes freed.
+ */
+static int nr_reclaim = 0;
+
+int reclaim_inodes(int dev)
+{
+	struct m_inode * inode;
+	int n = 0, idev;
+
+	if (!nr_reclaim)
+		return 0;
+	for (inode = inode_table ; inode < NR_INODE+inode_table ; inode++) {
+		if (!inode->i_reclaim || (dev && inode->i_dev != dev))
+			continue;
+		inode->i_reclaim = 0;
+		nr_reclaim--;
+		idev = inode->i_dev;
+		invalidate_pages(idev,inode->i_num);
+		journal_start(idev);
+		inode->i_op->truncate(inode);
+		get_super(idev)->s_op->free_inode(inode);
+		journal_stop(idev);
+		n++;
+	}
+	return n;
+}
+
 //放回一个i节点(回写入设备)
 //若是管道i节点，则唤醒等待的进程并递减引用计数
 //若是块设备i节点则刷新设备
 //若i节点的链接计数为0，则释放该i节点占用的所有磁盘逻辑块，并释放该i节点	
 void iput(struct m_inode * inode)
 {
+	int i;
+
 	//首先判断参数给出的i节点的有效性，并等待inode节点解锁(如果已上锁的话)
 	if (!inode)
 		return;
@@ -185,7 +511,9 @@ void iput(struct m_inode * inode)
 		wake_up(&inode->i_wait);
 		if (--inode->i_count)
 			return;
-		free_page(inode->i_size);
+		//释放管道缓冲区的所有页面(缩小过容量的管道也可能多占着页面)
+		for (i=0 ; i<PIPE_MAX_PAGES ; i++)
+			free_page(inode->i_pipe_page[i]);
 		inode->i_count=0;
 		inode->i_dirt=0;
 		inode->i_pipe=0;
@@ -212,12 +540,29 @@ repeat:
 	//如果该i节点的链接数为0，则说明该文件被删除
 	//于是释放该i节点的所有逻辑块，并释放该i节点
 	if (!inode->i_nlinks) {
-		truncate(inode);
+		//有间接块的大文件留给reclaim_inodes()去释放，删除操作不必等它
+		if (inode->i_op == &minix_inode_operations && !inode->i_reclaim &&
+		    (inode->i_zone[7] || inode->i_zone[8] || inode->i_zone[9])) {
+			inode->i_reclaim = 1;
+			nr_reclaim++;
+			return;
+		}
+		i = inode->i_dev;
+		invalidate_pages(i,inode->i_num);
+		journal_start(i);
+		inode->i_op->truncate(inode);
 		//用于实际释放i节点
 		//即复位i节点对应的i节点位图比特位，清空i节点结构内容
-		free_inode(inode);
+		get_super(inode->i_dev)->s_op->free_inode(inode);
+		journal_stop(i);
 		return;
 	}
+	//在i节点离开内存之前为延迟写数据分配磁盘块
+	if (inode->i_ndelay) {
+		alloc_delayed(inode);
+		wait_on_inode(inode);
+		goto repeat;
+	}
 	//如果该i节点已作过修改，则回写更新该i节点，并等待该i节点解锁
 	if (inode->i_dirt) {
 		write_inode(inode);	/* we can sleep - so do again */
@@ -238,6 +583,7 @@ struct m_inode * get_empty_inode(void)
 	static struct m_inode * last_inode = inode_table;		//指向i节点表第1项
 	int i;
 
+repeat:
 	do {
 	//在初始化last_inode指针指向i节点表头一项后循环扫描整个i节点表
 		inode = NULL;
@@ -254,6 +600,9 @@ struct m_inode * get_empty_inode(void)
 					break;
 			}
 		}
+		//等待释放的已删除文件还占着表项时，先释放它们再找
+		if (!inode && reclaim_inodes(0))
+			goto repeat;
 		//如果没有找到空闲i节点，则将i节点表打印出来供调试使用，并停机
 		if (!inode) {
 			for (i=0 ; i<NR_INODE ; i++)
@@ -285,19 +634,22 @@ struct m_inode * get_empty_inode(void)
 struct m_inode * get_pipe_inode(void)
 {
 	struct m_inode * inode;
+	int pages;
 
 	//首先从内存i节点表中取得一个空闲i节点
 	if (!(inode = get_empty_inode()))
 		return NULL;
-	//然后为该i节点申请一页内存，并让节点的i_size字段指向该页面
-	if (!(inode->i_size=get_free_page())) {
+	//然后为该i节点申请PIPE_DEF_PAGES页内存作为管道缓冲区，内存不够时页面数减半再试
+	//i节点逻辑块号数组i_zone[]的i_zone[0]和i_zone[1]中分别用来存放管道头和管道尾指针，i_zone[2]存放页面数
+	for (pages = PIPE_DEF_PAGES ; pages ; pages >>= 1)
+		if (pipe_set_pages(inode,pages) > 0)
+			break;
+	if (!pages) {
 		inode->i_count = 0;
 		return NULL;
 	}
-	//然后设置该i节点的引用计数为2，并复位管道头尾指针
-	//i节点逻辑块号数组i_zone[]的i_zone[0]和i_zone[1]中分别用来存放管道头和管道尾指针
+	//然后设置该i节点的引用计数为2
 	inode->i_count = 2;	/* sum of readers/writers */
-	PIPE_HEAD(*inode) = PIPE_TAIL(*inode) = 0;
 	//最后设置i节点为管道i节点标志，并返回该i节点
 	inode->i_pipe = 1;
 	return inode;
@@ -366,35 +718,207 @@ struct m_inode * iget(int dev,int nr)
 	return inode;
 }
 
-//读取指定i节点信息
-//从设备中读取含有指定i节点信息的i节点盘块，然后复制到指定的i节点结构中
+/*
+ * The in-memory inode is no longer a copy of the disk inode, as the v2
+ * layout differs from it. These two convert between the disk inode at p
+ * (in the format of sb) and the in-memory one.
+ */
+static void disk_to_inode(struct super_block * sb, char * p,
+	struct m_inode * inode)
+{
+	struct d_inode * d;
+	struct d2_inode * d2;
+	int i;
+
+	if (sb->s_version == 2) {
+		d2 = (struct d2_inode *) p;
+		inode->i_mode = d2->i_mode;
+		inode->i_uid = d2->i_uid;
+		inode->i_gid = d2->i_gid;
+		inode->i_nlinks = d2->i_nlinks;
+		inode->i_size = d2->i_size;
+		inode->i_atime = d2->i_atime;
+		inode->i_mtime = d2->i_mtime;
+		inode->i_ctime = d2->i_ctime;
+		for (i=0 ; i<10 ; i++)
+			inode->i_zone[i] = d2->i_zone[i];
+		return;
+	}
+	d = (struct d_inode *) p;
+	inode->i_mode = d->i_mode;
+	inode->i_uid = d->i_uid;
+	inode->i_size = d->i_size;
+	inode->i_mtime = d->i_time;
+	inode->i_gid = d->i_gid;
+	inode->i_nlinks = d->i_nlinks;
+	for (i=0 ; i<9 ; i++)
+		inode->i_zone[i] = d->i_zone[i];
+	inode->i_zone[9] = 0;
+}
+
+static void inode_to_disk(struct super_block * sb, struct m_inode * inode,
+	char * p)
+{
+	struct d_inode * d;
+	struct d2_inode * d2;
+	int i;
+
+	if (sb->s_version == 2) {
+		d2 = (struct d2_inode *) p;
+		d2->i_mode = inode->i_mode;
+		d2->i_uid = inode->i_uid;
+		d2->i_gid = inode->i_gid;
+		d2->i_nlinks = inode->i_nlinks;
+		d2->i_size = inode->i_size;
+		d2->i_atime = inode->i_atime;
+		d2->i_mtime = inode->i_mtime;
+		d2->i_ctime = inode->i_ctime;
+		for (i=0 ; i<10 ; i++)
+			d2->i_zone[i] = inode->i_zone[i];
+		return;
+	}
+	d = (struct d_inode *) p;
+	d->i_mode = inode->i_mode;
+	d->i_uid = inode->i_uid;
+	d->i_size = inode->i_size;
+	d->i_time = inode->i_mtime;
+	d->i_gid = inode->i_gid;
+	d->i_nlinks = inode->i_nlinks;
+	for (i=0 ; i<9 ; i++)
+		d->i_zone[i] = inode->i_zone[i];
+}
+
+/*
+ * fill_inodes() puts the other inodes of an inode-table block we have
+ * just read into unused slots of inode_table, so that iget() finds them
+ * without any I/O. Slots that still cache some other inode are left
+ * alone, and so are inodes that are free in the bitmap (their on-disk
+ * copy may be stale).
+ */
+static void fill_inodes(struct super_block * sb, struct buffer_head * bh,
+	int first)
+{
+	struct m_inode * inode, * slot = inode_table;
+	int nr;
+
+	for (nr = first ; nr < first+INODES_PER_BLOCK(sb) && nr <= sb->s_ninodes ; nr++) {
+		if (!(sb->s_imap[nr>>13]->b_data[(nr&8191)>>3] & (1<<(nr&7))))
+			continue;
+		for (inode = inode_table ; inode < NR_INODE+inode_table ; inode++)
+			if (inode->i_dev == sb->s_dev && inode->i_num == nr)
+				break;
+		if (inode < NR_INODE+inode_table)
+			continue;
+		while (slot->i_dev || slot->i_count || slot->i_lock || slot->i_dirt)
+			if (++slot >= NR_INODE+inode_table)
+				return;
+		memset(slot,0,sizeof(*slot));
+		disk_to_inode(sb,bh->b_data+(nr-first)*INODE_SIZE(sb),slot);
+		slot->i_dev = sb->s_dev;
+		slot->i_num = nr;
+		slot->i_op = &minix_inode_operations;
+	}
+}
+
+//读取指定i节点信息，由i节点所在文件系统的read_inode操作完成
 static void read_inode(struct m_inode * inode)
 {
 	struct super_block * sb;
+
+	if (!(sb=get_super(inode->i_dev)))
+		panic("trying to read inode without dev");
+	sb->s_op->read_inode(inode);
+}
+
+//将i节点信息写回，由所在文件系统的write_inode操作完成
+static void write_inode(struct m_inode * inode)
+{
+	struct super_block * sb;
+
+	if (!inode->i_dirt || !inode->i_dev)
+		return;
+	if (!(sb=get_super(inode->i_dev)))
+		panic("trying to write inode without device");
+	//只读文件系统上只会有访问时间之类的改动，丢弃即可
+	if (sb->s_rd_only) {
+		inode->i_dirt = 0;
+		return;
+	}
+	journal_start(sb->s_dev);
+	sb->s_op->write_inode(inode);
+	journal_stop(sb->s_dev);
+}
+
+/*
+ * read_disk_inode() reads inode nr of sb straight from the disk into a
+ * scratch inode, without going through inode_table. The journal uses
+ * it at mount time, before anything may be cached. Returns 0 on error.
+ */
+int read_disk_inode(struct super_block * sb, int nr, struct m_inode * inode)
+{
 	struct buffer_head * bh;
 	int block;
 
+	if (nr < 1 || nr > sb->s_ninodes)
+		return 0;
+	block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
+		(nr-1)/INODES_PER_BLOCK(sb);
+	if (!(bh = bread(sb->s_dev,block)))
+		return 0;
+	memset(inode,0,sizeof(*inode));
+	inode->i_dev = sb->s_dev;
+	inode->i_num = nr;
+	disk_to_inode(sb,bh->b_data+(nr-1)%INODES_PER_BLOCK(sb)*INODE_SIZE(sb),
+		inode);
+	brelse(bh);
+	return 1;
+}
+
+//minix文件系统的read_inode操作
+//从设备中读取含有指定i节点信息的i节点盘块，然后复制到指定的i节点结构中
+//若本次与上次读的i节点号相近(如遍历目录时逐个stat)，则同时预读后面的i节点块
+#define IREADA_WINDOW(sb) (2*INODES_PER_BLOCK(sb))
+
+void minix_read_inode(struct m_inode * inode)
+{
+	static int last_dev = 0, last_nr = 0;
+	struct super_block * sb;
+	struct buffer_head * bh;
+	int block,last,nr;
+
 	//首先锁定该i节点，并取该节点所在设备的超级块
 	lock_inode(inode);
 	if (!(sb=get_super(inode->i_dev)))
 		panic("trying to read inode without dev");
 	//该i节点所在的设备逻辑块号=(启动块+超级块)+i节点位图所占的块数+逻辑块位图所占的块数+(i节点号-1)/每块含有i节点结构数
 	block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
-		(inode->i_num-1)/INODES_PER_BLOCK;
+		(inode->i_num-1)/INODES_PER_BLOCK(sb);
+	last = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
+		(sb->s_ninodes-1)/INODES_PER_BLOCK(sb);
+	nr = inode->i_num;
 	//从设备上读取该i节点所在的逻辑块，并复制指定i节点内容到inode指针所指位置处
-	if (!(bh=bread(inode->i_dev,block)))
+	if (inode->i_dev == last_dev && nr > last_nr-IREADA_WINDOW(sb) &&
+	    nr < last_nr+IREADA_WINDOW(sb) && block < last)
+		bh = breada(inode->i_dev,block,block+1,
+			(block+2 <= last) ? block+2 : -1,-1);
+	else
+		bh = bread(inode->i_dev,block);
+	last_dev = inode->i_dev;
+	last_nr = nr;
+	if (!bh)
 		panic("unable to read i-node block");
-	*(struct d_inode *)inode =
-		((struct d_inode *)bh->b_data)
-			[(inode->i_num-1)%INODES_PER_BLOCK];
+	disk_to_inode(sb,bh->b_data+(nr-1)%INODES_PER_BLOCK(sb)*INODE_SIZE(sb),
+		inode);
+	inode->i_op = &minix_inode_operations;
+	fill_inodes(sb,bh,nr-(nr-1)%INODES_PER_BLOCK(sb));
 	//释放读入的缓冲块并解锁该i节点
 	brelse(bh);
 	unlock_inode(inode);
 }
 
-//将i节点信息写回缓冲区中
+//minix文件系统的write_inode操作
 //该函数把参数指定的i节点写入缓冲区相应的缓冲块中,待缓冲区刷新时会写入盘中
-static void write_inode(struct m_inode * inode)
+void minix_write_inode(struct m_inode * inode)
 {
 	struct super_block * sb;
 	struct buffer_head * bh;
@@ -408,14 +932,48 @@ static void write_inode(struct m_inode * inode)
 	if (!(sb=get_super(inode->i_dev)))
 		panic("trying to write inode without device");
 	block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
-		(inode->i_num-1)/INODES_PER_BLOCK;
+		(inode->i_num-1)/INODES_PER_BLOCK(sb);
 	if (!(bh=bread(inode->i_dev,block)))
 		panic("unable to read i-node block");
-	((struct d_inode *)bh->b_data)
-		[(inode->i_num-1)%INODES_PER_BLOCK] =
-			*(struct d_inode *)inode;
-	bh->b_dirt=1;
+	inode_to_disk(sb,inode,
+		bh->b_data+(inode->i_num-1)%INODES_PER_BLOCK(sb)*INODE_SIZE(sb));
+	journal_dirty(bh);
 	inode->i_dirt=0;
+	inode->i_dsync=0;
 	brelse(bh);
 	unlock_inode(inode);
 }
+
+/*
+ * sync_inode() writes the inode into its inode-table block and that
+ * block to the disk, and waits for it. Returns non-zero on error. With
+ * a journal, committing the transaction is enough.
+ */
+int sync_inode(struct m_inode * inode)
+{
+	struct super_block * sb;
+	struct buffer_head * bh;
+	int block,err;
+
+	journal_start(inode->i_dev);
+	minix_write_inode(inode);
+	journal_stop(inode->i_dev);
+	if (!(sb=get_super(inode->i_dev)))
+		return 1;
+	if (sb->s_journal)
+		return journal_commit(inode->i_dev) != 0;
+	block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
+		(inode->i_num-1)/INODES_PER_BLOCK(sb);
+	if (!(bh=get_hash_table(inode->i_dev,block)))
+		return 0;
+	//get_hash_table()会等待缓冲块解锁，再取一次就等到了写操作完成
+	if (bh->b_dirt) {
+		ll_rw_block(WRITE,bh);
+		brelse(bh);
+		if (!(bh=get_hash_table(inode->i_dev,block)))
+			return 0;
+	}
+	err = !bh->b_uptodate;
+	brelse(bh);
+	return err;
+}
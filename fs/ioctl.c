@@ -32,7 +32,7 @@ int sys_ioctl(unsigned int fd, unsigned int cmd, unsigned long arg)
 	struct file * filp;
 	int dev,mode;
 
-	if (fd >= NR_OPEN || !(filp = current->filp[fd]))
+	if (fd >= current->max_fds || !(filp = current->filp[fd]))
 		return -EBADF;
 	mode=filp->f_inode->i_mode;
 	if (!S_ISCHR(mode) && !S_ISBLK(mode))
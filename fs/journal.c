@@ -0,0 +1,559 @@
+/*
+ *  linux/fs/journal.c
+ */
+
+/*
+ * A write-ahead journal for the metadata of a minix file system. The log
+ * is the regular file /.journal (made with dd, at least J_MIN_LOG blocks
+ * and without holes). It is looked up when the file system is mounted.
+ * Without it everything works as before.
+ *
+ * Bitmap, inode-table, directory and indirect blocks are not simply
+ * marked dirty. journal_dirty() adds them to the running transaction,
+ * and they stay pinned there: b_count is held and ll_rw_block() won't
+ * write them. A commit copies all of them into the log with one
+ * sequential write: a descriptor with their block numbers, the copies,
+ * and a commit block with a checksum. After that they are ordinary dirty
+ * buffers, which go home whenever the buffer cache writes them.
+ *
+ * Operations that change metadata run between journal_start() and
+ * journal_stop(). A commit waits until no operation is half done, so a
+ * transaction only ever holds whole operations. The exception is a
+ * transaction that fills up: journal_dirty() then commits it with the
+ * operations that ran into the limit still half done, rather than leave
+ * a block out of the log. Many operations share
+ * one commit: it is made when the transaction is half full, J_INTERVAL
+ * ticks after it began, and on sync() and fsync().
+ *
+ * The log fills up from block 1. When it is full, or a block that may be
+ * in it was freed (and could be reused for data), everything committed
+ * is first written home and the log starts over. Block 0 then records
+ * the sequence number of the first transaction of the new round.
+ * Mounting replays the complete transactions of the current round.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/system.h>
+
+#define J_MAGIC 0x314c4e4a			//"JNL1"，日志头
+#define J_DESC 0x4353454a			//"JESC"，事务描述块
+#define J_COMMIT 0x4d4d434a			//"JCMM"，事务提交块
+#define J_INTERVAL (5*HZ)			//事务最多等这么久就提交
+
+//事务中最多的缓冲块数：日志还要容纳头块、描述块和提交块
+#define J_LIMIT(j) ((j)->j_nlog-3 < J_MAX_TRANS ? (j)->j_nlog-3 : J_MAX_TRANS)
+
+struct j_header {
+	unsigned long h_magic;
+	unsigned long h_seq;			//本轮第一个事务的序号
+};
+
+struct j_desc {
+	unsigned long d_magic;
+	unsigned long d_seq;
+	unsigned long d_count;			//事务中的块数
+	unsigned long d_home[J_MAX_TRANS];	//各块在设备上的块号
+};
+
+struct j_commit {
+	unsigned long c_magic;
+	unsigned long c_seq;
+	unsigned long c_count;
+	unsigned long c_sum;			//序号和各块内容的校验和
+};
+
+static inline void wait_on_buffer(struct buffer_head * bh)
+{
+	cli();
+	while (bh->b_lock)
+		sleep_on(&bh->b_wait);
+	sti();
+}
+
+static unsigned long checksum(char * data)
+{
+	unsigned long * p = (unsigned long *) data;
+	unsigned long sum = 0;
+	int i;
+
+	for (i=0 ; i<BLOCK_SIZE/4 ; i++)
+		sum += *p++;
+	return sum;
+}
+
+static struct journal * get_journal(int dev)
+{
+	struct super_block * sb;
+
+	if (!(sb = get_super(dev)))
+		return NULL;
+	return sb->s_journal;
+}
+
+//把数据data写到设备dev的block块并等待写完。用不在高速缓冲中的临时缓冲头，
+//这样写出的内容可以与高速缓冲中这一块的内容不同。成功返回1
+static int write_block(int dev, int block, char * data)
+{
+	struct buffer_head tmp;
+
+	memset(&tmp,0,sizeof(tmp));
+	tmp.b_dev = dev;
+	tmp.b_blocknr = block;
+	tmp.b_data = data;
+	tmp.b_uptodate = 1;
+	tmp.b_dirt = 1;
+	tmp.b_count = 1;
+	ll_rw_block(WRITE,&tmp);
+	wait_on_buffer(&tmp);
+	return tmp.b_uptodate;
+}
+
+/*
+ * Write everything committed so far home, then start a new round of the
+ * log. Called with j_committing set. Unpinned dirty buffers are written
+ * as they are. For the pinned ones (in the running transaction or held
+ * for the next one), the home copy must be their last committed content,
+ * read back from the log. Returns non-zero on a write error.
+ */
+static int checkpoint(int dev, struct journal * j)
+{
+	struct buffer_head * bh, * lb;
+	struct j_header * h;
+	int i,err = 0;
+
+	bh = start_buffer;
+	for (i=0 ; i<NR_BUFFERS ; i++,bh++)
+		if (bh->b_dev == dev && !bh->b_jtrans) {
+			bh->b_jlog = 0;
+			if (bh->b_dirt)
+				ll_rw_block(WRITE,bh);
+		}
+	bh = start_buffer;
+	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+		if (bh->b_dev != dev || !bh->b_jtrans || !bh->b_jlog)
+			continue;
+		if (!(lb = bread(dev,j->j_blocks[bh->b_jlog]))) {
+			err = 1;
+			continue;
+		}
+		err |= !write_block(dev,bh->b_blocknr,lb->b_data);
+		brelse(lb);
+		bh->b_jlog = 0;
+	}
+	bh = start_buffer;
+	for (i=0 ; i<NR_BUFFERS ; i++,bh++)
+		if (bh->b_dev == dev)
+			wait_on_buffer(bh);
+	//新一轮从日志第1块开始，第一个事务就是当前事务
+	if (!(lb = getblk(dev,j->j_blocks[0])))
+		return 1;
+	memset(lb->b_data,0,BLOCK_SIZE);
+	h = (struct j_header *) lb->b_data;
+	h->h_magic = J_MAGIC;
+	h->h_seq = j->j_seq;
+	lb->b_uptodate = 1;
+	lb->b_dirt = 1;
+	ll_rw_block(WRITE,lb);
+	wait_on_buffer(lb);
+	err |= !lb->b_uptodate;
+	brelse(lb);
+	j->j_head = 1;
+	j->j_revoke = 0;
+	return err;
+}
+
+/*
+ * Commit the running transaction. The log buffers are got first, as
+ * getblk() may sleep. The copies are then taken without sleeping, with
+ * no operation half done other than those waiting in journal_dirty()
+ * for the transaction to make room.
+ */
+/*
+ * Put the blocks that were held for the transaction that has just begun
+ * (see journal_dirty()) into it. Whatever doesn't fit waits for the one
+ * after. Must not sleep between j_seq++ and this.
+ */
+static void add_held(int dev, struct journal * j)
+{
+	struct buffer_head * bh;
+	int i;
+
+	j->j_held = 0;
+	bh = start_buffer;
+	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+		if (bh->b_dev != dev || bh->b_jtrans != j->j_seq)
+			continue;
+		if (j->j_n >= J_LIMIT(j)) {
+			bh->b_jtrans = j->j_seq+1;
+			j->j_held = 1;
+			continue;
+		}
+		if (!j->j_n)
+			j->j_start = jiffies;
+		j->j_bh[j->j_n++] = bh;
+	}
+}
+
+static int do_commit(int dev, struct journal * j)
+{
+	struct buffer_head * bh;
+	struct j_desc * d;
+	struct j_commit * c;
+	unsigned long seq,sum;
+	int i,k,n,got = 0,err = 0;
+
+	while (j->j_committing)
+		sleep_on(&j->j_wait);
+	j->j_committing = 1;
+	j->j_committer = current;
+	for (;;) {
+		while (j->j_handles > j->j_full)
+			sleep_on(&j->j_wait);
+		if (!(n = j->j_n))
+			break;
+		if (j->j_revoke || j->j_head+n+2 > j->j_nlog) {
+			while (got)
+				brelse(j->j_lb[--got]);
+			err |= checkpoint(dev,j);
+			continue;
+		}
+		for ( ; got < n+2 ; got++)
+			j->j_lb[got] = getblk(dev,j->j_blocks[j->j_head+got]);
+		if (j->j_handles <= j->j_full && j->j_n == n && !j->j_revoke)
+			break;
+	}
+	if (n) {
+		seq = j->j_seq;
+		d = (struct j_desc *) j->j_lb[0]->b_data;
+		memset(d,0,BLOCK_SIZE);
+		d->d_magic = J_DESC;
+		d->d_seq = seq;
+		sum = seq;
+		//被释放的块在事务中留下空项，跳过它们
+		for (i=k=0 ; i<n ; i++) {
+			if (!(bh = j->j_bh[i]))
+				continue;
+			d->d_home[k] = bh->b_blocknr;
+			memcpy(j->j_lb[k+1]->b_data,bh->b_data,BLOCK_SIZE);
+			sum += checksum(bh->b_data);
+			bh->b_jlog = j->j_head+k+1;
+			j->j_cbh[k++] = bh;
+		}
+		d->d_count = k;
+		c = (struct j_commit *) j->j_lb[k+1]->b_data;
+		memset(c,0,BLOCK_SIZE);
+		c->c_magic = J_COMMIT;
+		c->c_seq = seq;
+		c->c_count = k;
+		c->c_sum = sum;
+		//从现在起的修改属于下一个事务
+		j->j_n = 0;
+		j->j_seq++;
+		if (j->j_held)
+			add_held(dev,j);
+		j->j_head += k+2;
+		while (got > k+2)
+			brelse(j->j_lb[--got]);
+		for (i=0 ; i<got ; i++) {
+			j->j_lb[i]->b_uptodate = 1;
+			j->j_lb[i]->b_dirt = 1;
+			ll_rw_block(WRITE,j->j_lb[i]);
+		}
+		for (i=0 ; i<got ; i++) {
+			wait_on_buffer(j->j_lb[i]);
+			err |= !j->j_lb[i]->b_uptodate;
+			brelse(j->j_lb[i]);
+		}
+		//已提交的块不再钉住，除非它在提交期间又加入了下一个事务
+		for (i=0 ; i<k ; i++)
+			if ((bh = j->j_cbh[i])->b_jtrans == seq) {
+				bh->b_jtrans = 0;
+				brelse(bh);
+			}
+	}
+	j->j_committing = 0;
+	j->j_committer = NULL;
+	wake_up(&j->j_wait);
+	return err;
+}
+
+void journal_start(int dev)
+{
+	struct journal * j;
+
+	if (j = get_journal(dev))
+		j->j_handles++;
+}
+
+//结束一个修改操作。没有其他操作在进行并且事务该提交了，就在这里提交
+void journal_stop(int dev)
+{
+	struct journal * j;
+
+	if (!(j = get_journal(dev)) || !j->j_handles)
+		return;
+	//提交可能在等其余的操作都停在journal_dirty()中
+	j->j_handles--;
+	wake_up(&j->j_wait);
+	if (j->j_handles)
+		return;
+	if (j->j_n && !j->j_committing && (j->j_n >= J_LIMIT(j)/2 ||
+	    jiffies - j->j_start >= J_INTERVAL))
+		do_commit(dev,j);
+}
+
+//元数据缓冲块bh已修改。有日志时把它加入当前事务，否则只置已修改标志
+void journal_dirty(struct buffer_head * bh)
+{
+	struct journal * j;
+
+	bh->b_dirt = 1;
+	if (!(j = get_journal(bh->b_dev)) || bh->b_jtrans == j->j_seq)
+		return;
+	//事务已满：先提交它(本操作已做的部分也在其中)，腾出地方再记录这一块。
+	//提交本身取日志缓冲块时可能经sync_dev()回到这里，那时不能等自己，
+	//就把这一块钉住留给下一个事务，免得它在日志之前被写回原处
+	while (j->j_n >= J_LIMIT(j)) {
+		if (j->j_committing && j->j_committer == current) {
+			if (!bh->b_jtrans)
+				bh->b_count++;
+			bh->b_jtrans = j->j_seq+1;
+			j->j_held = 1;
+			return;
+		}
+		j->j_full++;
+		wake_up(&j->j_wait);
+		do_commit(bh->b_dev,j);
+		j->j_full--;
+	}
+	if (bh->b_jtrans == j->j_seq)
+		return;
+	if (!bh->b_jtrans)
+		bh->b_count++;
+	bh->b_jtrans = j->j_seq;
+	if (!j->j_n)
+		j->j_start = jiffies;
+	j->j_bh[j->j_n++] = bh;
+}
+
+//bh所在的块被释放了，从当前事务中去掉(留下空项)并解除钉住
+void journal_forget(struct buffer_head * bh)
+{
+	struct journal * j;
+	int i;
+
+	if (!bh->b_jtrans)
+		return;
+	if (j = get_journal(bh->b_dev))
+		for (i=0 ; i<j->j_n ; i++)
+			if (j->j_bh[i] == bh)
+				j->j_bh[i] = NULL;
+	bh->b_jtrans = 0;
+	bh->b_jlog = 0;
+	bh->b_count--;
+}
+
+//释放了可能记录在日志中的块(目录块或间接块)，重放时不能再用日志中的旧内容
+//覆盖它，因此下次提交之前日志要重新开始一轮
+void journal_revoke(int dev)
+{
+	struct journal * j;
+
+	if (j = get_journal(dev))
+		j->j_revoke = 1;
+}
+
+int journal_commit(int dev)
+{
+	struct journal * j;
+
+	if (!(j = get_journal(dev)))
+		return 0;
+	return do_commit(dev,j) ? -EIO : 0;
+}
+
+void sync_journals(void)
+{
+	struct super_block * sb;
+
+	for (sb = 0+super_block ; sb < NR_SUPER+super_block ; sb++)
+		if (sb->s_dev && sb->s_journal)
+			do_commit(sb->s_dev,sb->s_journal);
+}
+
+//inode是否是已安装文件系统正在使用的日志文件
+int is_journal(struct m_inode * inode)
+{
+	struct journal * j;
+
+	return (j = get_journal(inode->i_dev)) && j->j_inode == inode;
+}
+
+//在根目录中找日志文件，返回其i节点号。这时还不能用namei()和iget()
+static int find_journal(struct m_inode * dir)
+{
+	struct buffer_head * bh = NULL;
+	struct dir_entry * de = NULL;
+	int i,block,entries,ino = 0;
+
+	entries = dir->i_size / (sizeof (struct dir_entry));
+	for (i=0 ; !ino && i<entries ; i++) {
+		if (!(i % DIR_ENTRIES_PER_BLOCK)) {
+			if (i)
+				brelse(bh);
+			if (!(block = bmap(dir,i/DIR_ENTRIES_PER_BLOCK)) ||
+			    !(bh = bread(dir->i_dev,block)))
+				return 0;
+			de = (struct dir_entry *) bh->b_data;
+		}
+		if (de->inode && !strncmp(de->name,".journal",NAME_LEN))
+			ino = de->inode;
+		de++;
+	}
+	if (entries)
+		brelse(bh);
+	return ino;
+}
+
+//重放日志中本轮完整提交了的事务，返回重放的事务数
+static int replay(int dev, struct journal * j)
+{
+	struct buffer_head * bh, * db, * cb, * hb;
+	struct j_desc * d;
+	struct j_commit * c;
+	unsigned long sum;
+	int i,pos,n,count = 0;
+
+	if (!(bh = bread(dev,j->j_blocks[0])))
+		return 0;
+	if (((struct j_header *) bh->b_data)->h_magic != J_MAGIC) {
+		brelse(bh);
+		j->j_seq = 1;
+		return 0;
+	}
+	j->j_seq = ((struct j_header *) bh->b_data)->h_seq;
+	brelse(bh);
+	for (pos = 1 ; pos+2 <= j->j_nlog ; pos += n+2) {
+		if (!(db = bread(dev,j->j_blocks[pos])))
+			break;
+		d = (struct j_desc *) db->b_data;
+		n = d->d_count;
+		if (d->d_magic != J_DESC || d->d_seq != j->j_seq ||
+		    n > J_MAX_TRANS || pos+n+2 > j->j_nlog) {
+			brelse(db);
+			break;
+		}
+		//先核对提交块和校验和，事务完整才重放
+		sum = j->j_seq;
+		for (i=0 ; i<n ; i++) {
+			if (!(bh = bread(dev,j->j_blocks[pos+1+i])))
+				break;
+			sum += checksum(bh->b_data);
+			brelse(bh);
+		}
+		if (i < n || !(cb = bread(dev,j->j_blocks[pos+1+n]))) {
+			brelse(db);
+			break;
+		}
+		c = (struct j_commit *) cb->b_data;
+		if (c->c_magic != J_COMMIT || c->c_seq != j->j_seq ||
+		    c->c_count != n || c->c_sum != sum) {
+			brelse(cb);
+			brelse(db);
+			break;
+		}
+		brelse(cb);
+		for (i=0 ; i<n ; i++) {
+			if (!(bh = bread(dev,j->j_blocks[pos+1+i])))
+				continue;
+			if (hb = getblk(dev,d->d_home[i])) {
+				memcpy(hb->b_data,bh->b_data,BLOCK_SIZE);
+				hb->b_uptodate = 1;
+				hb->b_dirt = 1;
+				brelse(hb);
+			}
+			brelse(bh);
+		}
+		brelse(db);
+		j->j_seq++;
+		count++;
+	}
+	return count;
+}
+
+/*
+ * Called by read_super() once a minix file system is read in. If it has
+ * a /.journal, replay it, write the result home and start a new round.
+ * Returns the number of transactions replayed (the caller then has to
+ * recount the free blocks and inodes).
+ */
+int journal_load(struct super_block * sb)
+{
+	struct m_inode tmp;
+	struct journal * j;
+	int i,n,ino,count;
+
+	if (!read_disk_inode(sb,ROOT_INO,&tmp) || !(ino = find_journal(&tmp)))
+		return 0;
+	if (!read_disk_inode(sb,ino,&tmp) || !S_ISREG(tmp.i_mode))
+		return 0;
+	if ((n = tmp.i_size >> BLOCK_SIZE_BITS) < J_MIN_LOG) {
+		printk("journal on dev %04x too small, not used\n\r",sb->s_dev);
+		return 0;
+	}
+	if (n > J_MAX_LOG)
+		n = J_MAX_LOG;
+	if (!(j = (struct journal *) get_free_page()))
+		return 0;
+	for (i=0 ; i<n ; i++)
+		if (!(j->j_blocks[i] = bmap(&tmp,i))) {
+			printk("journal on dev %04x has holes, not used\n\r",
+				sb->s_dev);
+			free_page((long) j);
+			return 0;
+		}
+	j->j_nlog = n;
+	if (count = replay(sb->s_dev,j)) {
+		printk("journal: %d transactions replayed on dev %04x\n\r",
+			count,sb->s_dev);
+		invalidate_inodes(sb->s_dev);
+	}
+	j->j_committing = 1;
+	if (checkpoint(sb->s_dev,j)) {
+		printk("journal on dev %04x: write error, not used\n\r",sb->s_dev);
+		free_page((long) j);
+		return count;
+	}
+	j->j_committing = 0;
+	j->j_inode = iget(sb->s_dev,ino);
+	sb->s_journal = j;
+	return count;
+}
+
+//卸载前调用：提交当前事务并把全部内容写回原处，下次安装时就没有要重放的了
+void journal_release(struct super_block * sb)
+{
+	struct journal * j;
+	struct m_inode * inode;
+
+	if (!(j = sb->s_journal))
+		return;
+	//提交时留给下一个事务的块也要提交掉，不能留着钉住
+	do
+		do_commit(sb->s_dev,j);
+	while (j->j_n);
+	while (j->j_committing)
+		sleep_on(&j->j_wait);
+	j->j_committing = 1;
+	checkpoint(sb->s_dev,j);
+	inode = j->j_inode;
+	sb->s_journal = NULL;
+	free_page((long) j);
+	iput(inode);
+}
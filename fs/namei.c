@@ -65,6 +65,7 @@ static int permission(struct m_inode * inode,int mask)
 static int match(int len,const char * name,struct dir_entry * de)
 {
 	register int same __asm__("ax");
+	int d0,d1,d2;
 
 	if (!de || !de->inode || len > NAME_LEN)
 		return 0;
@@ -75,9 +76,9 @@ static int match(int len,const char * name,struct dir_entry * de)
 	__asm__("cld\n\t"			//清方向位
 		"fs ; repe ; cmpsb\n\t"			//用户空间执行循环比较[esi+1]和[edi+1]
 		"setz %%al"					//若结果一样(z=0)则设置al=1(same=eax)
-		:"=a" (same)
-		:"0" (0),"S" ((long) name),"D" ((long) de->name),"c" (len)
-		:"cx","di","si");
+		:"=a" (same),"=S" (d0),"=D" (d1),"=c" (d2)
+		:"0" (0),"1" ((long) name),"2" ((long) de->name),"3" (len)
+		:"memory");
 	return same;
 }
 
@@ -89,19 +90,18 @@ static int match(int len,const char * name,struct dir_entry * de)
  * itself (as a parameter - res_dir). It does NOT read the inode of the
  * entry - you'll have to do that yourself if you want to.
  *
- * This also takes care of the few special cases due to '..'-traversal
- * over a pseudo-root and a mount point.
+ * The special cases of '..' over a pseudo-root and a mount point are
+ * taken care of by lookup(), for every file system type.
  */
 //在指定目录中寻找到一个与名字匹配的目录项
 //返回一个含有找到目录项的高速缓冲块以及目录项本身(作为一个参数res_dir)
-static struct buffer_head * find_entry(struct m_inode ** dir,
-	const char * name, int namelen, struct dir_entry ** res_dir)
+static struct buffer_head * find_entry(struct m_inode * dir,
+	const char * name, int namelen, struct dir_entry ** res_dir, int * res_nr)
 {
 	int entries;
 	int block,i;
 	struct buffer_head * bh;
 	struct dir_entry * de;
-	struct super_block * sb;
 
 //对函数参数有效性进行判断和验证
 #ifdef NO_TRUNCATE
@@ -112,34 +112,17 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 		namelen = NAME_LEN;
 #endif
 	//首先计算本目录中目录项项数entries
-	entries = (*dir)->i_size / (sizeof (struct dir_entry));
+	entries = dir->i_size / (sizeof (struct dir_entry));
 	*res_dir = NULL;
 	if (!namelen)
 		return NULL;
-/* check for '..', as we might have to do some "magic" for it */
-	//接下来对目录项文件名是''..'的情况进行特殊处理
-	if (namelen==2 && get_fs_byte(name)=='.' && get_fs_byte(name+1)=='.') {
-/* '..' in a pseudo-root results in a faked '.' (just change namelen) */
-		if ((*dir) == current->root)
-			namelen=1;
-		else if ((*dir)->i_num == ROOT_INO) {
-/* '..' over a mount-point results in 'dir' being exchanged for the mounted
-   directory-inode. NOTE! We set mounted, so that we can iput the new dir */
-			sb=get_super((*dir)->i_dev);
-			if (sb->s_imount) {
-				iput(*dir);
-				(*dir)=sb->s_imount;
-				(*dir)->i_count++;
-			}
-		}
-	}
 	//查找指定文件名的目录项在什么地方
 	//因此我们需要读取目录的数据，即取出目录i节点对应块设备数据区中的数据块(逻辑块)信息
 	//这些逻辑块的块号保存在i节点结构的i_zone[9]数组中，我们先取其中第1个块号
-	if (!(block = (*dir)->i_zone[0]))
+	if (!(block = bmap(dir,0)))
 		return NULL;
 	//从节点所在设备读取指定的目录项数据块
-	if (!(bh = bread((*dir)->i_dev,block)))
+	if (!(bh = bread(dir->i_dev,block)))
 		return NULL;
 	//此时我们就在这个读取的目录i节点数据块中搜索匹配指定文件名的目录项
 	//首先让de指向缓冲块中的数据块部分，并在不超过目录中目录项数的条件下循环执行搜索
@@ -151,16 +134,18 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 			brelse(bh);
 			bh = NULL;
 			//再读入目录的下一个逻辑块
-			if (!(block = bmap(*dir,i/DIR_ENTRIES_PER_BLOCK)) ||
-			    !(bh = bread((*dir)->i_dev,block))) {
+			if (!(block = bmap(dir,i/DIR_ENTRIES_PER_BLOCK)) ||
+			    !(bh = bread(dir->i_dev,block))) {
 				i += DIR_ENTRIES_PER_BLOCK;
 				continue;
 			}
 			de = (struct dir_entry *) bh->b_data;
 		}
-		//如果找到匹配的目录项的话，则返回该目录项结构指针de和该目录项i节点指针*dir以及目录项数据块指针bh
+		//如果找到匹配的目录项的话，则返回该目录项结构指针de和该目录项以及目录项数据块指针bh
 		if (match(namelen,name,de)) {
 			*res_dir = de;
+			if (res_nr)
+				*res_nr = i;
 			return bh;
 		}
 		de++;
@@ -204,15 +189,18 @@ static struct buffer_head * add_entry(struct m_inode * dir,
 	//先读取目录的数据，即取出目录i节点对应块设备数据取中的数据块信息
 	if (!namelen)
 		return NULL;
-	if (!(block = dir->i_zone[0]))
+	//从i_dfree处开始找：它前面的目录项都在使用中(删除目录项时会把它调低)
+	//它已在目录末尾时直接在末尾添加，这样在大目录中建文件不必从头扫描
+	i = dir->i_dfree;
+	if (i*sizeof(struct dir_entry) > dir->i_size)
+		i = dir->i_size / sizeof(struct dir_entry);
+	if (!(block = create_block(dir,i/DIR_ENTRIES_PER_BLOCK)))
 		return NULL;
 	if (!(bh = bread(dir->i_dev,block)))
 		return NULL;
 	//此时我们就在这个目录i节点数据块中循环查找未使用的空目录项
-	//首先让目录项结构指针de指向缓冲块中的数据块部分，即第一个目录项处
-	//其中i是目录中的目录项索引号，在循环开始时初始化为0
-	i = 0;
-	de = (struct dir_entry *) bh->b_data;
+	//让目录项结构指针de指向第i个目录项
+	de = i%DIR_ENTRIES_PER_BLOCK + (struct dir_entry *) bh->b_data;
 	while (1) {
 		//如果当前目录项数据块已经搜索完毕，但还没有找到需要的空目录项，
 		//则释放当前目录项数据块，再读入目录的下一个逻辑块
@@ -236,13 +224,14 @@ static struct buffer_head * add_entry(struct m_inode * dir,
 		}
 		//若当前搜索的目录项de的i节点为空，则表示找到一个还未使用的空闲目录项或者是添加的新目录项
 		if (!de->inode) {
+			dir->i_dfree = i+1;
 			//于是更新目录的修改时间为当前时间
 			dir->i_mtime = CURRENT_TIME;
 			//并从用户数据区复制文件名到该目录项的文件名字段
 			for (i=0; i < NAME_LEN ; i++)
 				de->name[i]=(i<namelen)?get_fs_byte(name+i):0;
 			//置含有本目录项的相应高速缓冲块已修改标志
-			bh->b_dirt = 1;
+			journal_dirty(bh);
 			//返回该目录项的指针以及该高速缓冲块的指针
 			*res_dir = de;
 			return bh;
@@ -256,342 +245,119 @@ static struct buffer_head * add_entry(struct m_inode * dir,
 }
 
 /*
- *	get_dir()
- *
- * Getdir traverses the pathname until it hits the topmost directory.
- * It returns NULL on failure.
- */
-//该函数根据给出的路径名进行搜索，直到达到最顶端的目录。如果失败返回NULL
-//返回目录或文件的i节点指针
-static struct m_inode * get_dir(const char * pathname)
-{
-	char c;
-	const char * thisname;
-	struct m_inode * inode;
-	struct buffer_head * bh;
-	int namelen,inr,idev;
-	struct dir_entry * de;
-
-	//搜索操作会从当前进程任务结构中设置的根i节点或当前工作目录i节点开始
-	if (!current->root || !current->root->i_count)		//当前进程的根i节点不存在或引用计数为0，则死机
-		panic("No root inode");
-	if (!current->pwd || !current->pwd->i_count)		//当前进程的当前工作目录根i节点不存在或引用计数为0，则死机
-		panic("No cwd inode");
-	//如果用户指定的路径名的第1个字符是'/'，则说明路径名是绝对路径名
-	if ((c=get_fs_byte(pathname))=='/') {
-		inode = current->root;
-		pathname++;
-	//否则若第一个字符是其他字符，则表示给定的是相对路径名，应从进程的当前工作目录开始操作
-	} else if (c)
-		inode = current->pwd;
-	else
-		return NULL;	/* empty name is bad */
-	//i节点引用计数增1
-	inode->i_count++;
-	//然后针对路径名中的各个目录名部分和文件名进行循环处理
-	while (1) {
-		thisname = pathname;
-		//先对当前正在处理的目录名部分(或文件名)的i节点进行有效性判断
-		if (!S_ISDIR(inode->i_mode) || !permission(inode,MAY_EXEC)) {
-			iput(inode);
-			return NULL;
-		}
-		//每当检索到字符串中的'/'字符或者c为'\0'，循环都会跳出
-		for(namelen=0;(c=get_fs_byte(pathname++))&&(c!='/');namelen++)
-			/* nothing */ ;
-		if (!c)
-			return inode;
-		//在当前处理的目录中寻找指定名称的目录项
-		if (!(bh = find_entry(&inode,thisname,namelen,&de))) {
-			iput(inode);
-			return NULL;
-		}
-		//在找到的目录项中取出其i节点号inr和设备号idev
-		inr = de->inode;
-		idev = inode->i_dev;
-		//释放包含该目录项的高速缓冲块并放回该i节点
-		brelse(bh);
-		iput(inode);
-		//然后取节点号的nr的i节点inode，并以该目录项为当前目录继续循环处理路径名中的下一目录名部分(或文件名)
-		if (!(inode = iget(idev,inr)))
-			return NULL;
-	}
-}
-
-/*
- *	dir_namei()
- *
- * dir_namei() returns the inode of the directory of the
- * specified name, and the name within that directory.
- */
-//函数返回指定目录名的i节点指针以及在最顶层目录的名称
-static struct m_inode * dir_namei(const char * pathname,
-	int * namelen, const char ** name)
-{
-	char c;
-	const char * basename;
-	struct m_inode * dir;
-
-	//首先取得指定路径名最顶层目录的i节点
-	if (!(dir = get_dir(pathname)))
-		return NULL;
-	basename = pathname;
-	//逐个遍历/dev/tty0字符串，每次循环都将一个字符复制给c，直到字符串结束
-	while (c=get_fs_byte(pathname++))
-		if (c=='/')
-			basename=pathname;
-	*namelen = pathname-basename-1;		//确定tty0名字的长度
-	*name = basename;		//得到tty0中第一个't'字符的地址
-	return dir;		
-}
-
-/*
- *	namei()
- *
- * is used by most simple commands to get the inode of a specified name.
- * Open, link etc use their own routines, but this is enough for things
- * like 'chmod' etc.
+ * The minix directory operations. They find and add entries with
+ * find_entry() and add_entry() above; namei() and the system calls
+ * below reach them through minix_inode_operations.
  */
-//取指定路径名的i节点
-//参数：pathname-路径名
-//返回：对应的i节点
-struct m_inode * namei(const char * pathname)
+static int minix_lookup(struct m_inode * dir, const char * name, int len,
+	struct m_inode ** res_inode)
 {
-	const char * basename;
-	int inr,dev,namelen;
-	struct m_inode * dir;
 	struct buffer_head * bh;
 	struct dir_entry * de;
+	int inr;
 
-	//首先查找指定路径的最顶层目录的目录名并得到其i节点，若不存在则返回NULL退出
-	if (!(dir = dir_namei(pathname,&namelen,&basename)))
-		return NULL;
-	//如果返回的最顶层名字的长度是0，则表示该路径名以一个目录名为最后一项
-	//因此我们已经找到对应目录的i节点，可以直接返回该i节点退出
-	if (!namelen)			/* special case: '/usr/' etc */
-		return dir;
-	//然后在返回的顶层目录中寻找指定文件名目录项的i节点
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (!bh) {
-		iput(dir);
-		return NULL;
-	}
-	//接着取该目录项的i节点号和设备号，并释放包含该目录项的高速缓冲块并放回目录i节点
+	*res_inode = NULL;
+	if (!(bh = find_entry(dir,name,len,&de,NULL)))
+		return -ENOENT;
+	//取出目录项的i节点号，释放包含该目录项的高速缓冲块后再取i节点
 	inr = de->inode;
-	dev = dir->i_dev;
 	brelse(bh);
-	iput(dir);
-	//然后取对应节点号的i节点
-	dir=iget(dev,inr);
-	//修改其被访问时间为当前时间并置已修改标志
-	if (dir) {
-		dir->i_atime=CURRENT_TIME;
-		dir->i_dirt=1;
-	}
-	//最后返回该i节点
-	return dir;
+	if (!(*res_inode = iget(dir->i_dev,inr)))
+		return -EACCES;
+	return 0;
 }
 
-/*
- *	open_namei()
- *
- * namei for open - this is in fact almost the whole open-routine.
- */
-//open()函数使用的namei函数-这其实几乎是完整的打开文件程序
-//res_inode-返回对应文件路径名的i节点指针
-int open_namei(const char * pathname, int flag, int mode,
-	struct m_inode ** res_inode)
+static int minix_create(struct m_inode * dir, const char * name, int len,
+	int mode, struct m_inode ** res_inode)
 {
-	const char * basename;
-	int inr,dev,namelen;
-	struct m_inode * dir, *inode;
+	struct m_inode * inode;
 	struct buffer_head * bh;
 	struct dir_entry * de;
 
-	//首先对函数参数进行合理的处理
-	if ((flag & O_TRUNC) && !(flag & O_ACCMODE))
-		flag |= O_WRONLY;
-	mode &= 0777 & ~current->umask;
-	mode |= I_REGULAR;
-	//然后根据指定的路径名寻找到对应的i节点以及最顶端目录名及其长度
-	if (!(dir = dir_namei(pathname,&namelen,&basename)))
-		return -ENOENT;
-	//此时如果最顶端目录名长度为0(例如'/usr/'这种路径名的情况)
-	//那么若操作不是读写、创建和文件长度截0，则表示是在打开一个目录名文件操作，
-	//于是直接返回该目录的i节点并返回0退出
-	if (!namelen) {			/* special case: '/usr/' etc */
-		if (!(flag & (O_ACCMODE|O_CREAT|O_TRUNC))) {
-			*res_inode=dir;
-			return 0;
-		}
-		//否则说明进程操作非法，于是放回i节点并返回出错码
-		iput(dir);
-		return -EISDIR;
-	}
-	//接着根据上面得到的最顶层目录名的i节点dir，在其中查找取得路径名字字符串中最后的
-	//文件名对应的目录项结构de，并同时得到该目录所在的高速缓冲区指针
-	bh = find_entry(&dir,basename,namelen,&de);
-	//如果该高速缓冲指针为NULL，则表示没有找到对应文件名的目录项，因此只可能是创建文件操作
+	*res_inode = NULL;
+	//在目录i节点对应设备上申请一个新的i节点给路径名上指定的文件使用
+	if (!(inode = new_inode(dir->i_dev,dir->i_num)))
+		return -ENOSPC;
+	//对新的i节点进行初始设置
+	inode->i_uid = current->euid;
+	inode->i_mode = mode;
+	inode->i_dirt = 1;
+	//然后在指定目录dir中添加一个新目录项
+	bh = add_entry(dir,name,len,&de);
+	//如果添加目录项操作失败
 	if (!bh) {
-		//如果不是创建文件，则放回该目录的i节点，返回出错号退出
-		if (!(flag & O_CREAT)) {
-			iput(dir);
-			return -ENOENT;
-		}
-		//如果用户在该目录没有写的权力，则放回该目录的i节点，返回出错号退出
-		if (!permission(dir,MAY_WRITE)) {
-			iput(dir);
-			return -EACCES;
-		}
-		//现在确定是创建文件并有写操作许可
-		//在目录i节点对应设备上申请一个新的i节点给路径名上指定的文件使用
-		inode = new_inode(dir->i_dev);
-		if (!inode) {
-			iput(dir);
-			return -ENOSPC;
-		}
-		//对新的i节点进行初始设置
-		inode->i_uid = current->euid;
-		inode->i_mode = mode;
-		inode->i_dirt = 1;
-		//然后在指定目录dir中添加一个新目录项
-		bh = add_entry(dir,basename,namelen,&de);
-		//如果添加目录项操作失败
-		if (!bh) {
-			inode->i_nlinks--;
-			iput(inode);
-			iput(dir);
-			return -ENOSPC;
-		}
-		//说明添加目录项操作成功，设置新目录项的初始值
-		//置目录项i节点为新申请到的i节点的号码
-		de->inode = inode->i_num;
-		bh->b_dirt = 1;
-		//释放该高速缓冲区并放回目录的i节点
-		brelse(bh);
-		iput(dir);
-		//返回新目录的i节点指针
-		*res_inode = inode;
-		return 0;
-	}
-	inr = de->inode;		//得到i节点号
-	dev = dir->i_dev;		//得到虚拟盘的设备号
-	//释放该高速缓冲区并放回目录的i节点
-	brelse(bh);
-	iput(dir);
-	if (flag & O_EXCL)
-		return -EEXIST;
-	//然后我们读取该目录项的i节点内容
-	if (!(inode=iget(dev,inr)))
-		return -EACCES;
-	if ((S_ISDIR(inode->i_mode) && (flag & O_ACCMODE)) ||
-	    !permission(inode,ACC_MODE(flag))) {
+		inode->i_nlinks--;
 		iput(inode);
-		return -EPERM;
+		return -ENOSPC;
 	}
-	//接着我们更新该i节点的访问时间字段值为当前时间
-	inode->i_atime = CURRENT_TIME;
-	if (flag & O_TRUNC)
-		truncate(inode);
-	//返回该目录项i节点的指针
+	//说明添加目录项操作成功，设置新目录项的初始值
+	//置目录项i节点为新申请到的i节点的号码
+	de->inode = inode->i_num;
+	journal_dirty(bh);
+	brelse(bh);
 	*res_inode = inode;
 	return 0;
 }
 
-int sys_mknod(const char * filename, int mode, int dev)
+static int minix_mknod(struct m_inode * dir, const char * name, int len,
+	int mode, int rdev)
 {
-	const char * basename;
-	int namelen;
-	struct m_inode * dir, * inode;
+	struct m_inode * inode;
 	struct buffer_head * bh;
 	struct dir_entry * de;
-	
-	if (!suser())
-		return -EPERM;
-	if (!(dir = dir_namei(filename,&namelen,&basename)))
-		return -ENOENT;
-	if (!namelen) {
-		iput(dir);
-		return -ENOENT;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EPERM;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
+
+	bh = find_entry(dir,name,len,&de,NULL);
 	if (bh) {
 		brelse(bh);
-		iput(dir);
 		return -EEXIST;
 	}
-	inode = new_inode(dir->i_dev);
-	if (!inode) {
-		iput(dir);
+	inode = new_inode(dir->i_dev,dir->i_num);
+	if (!inode)
 		return -ENOSPC;
-	}
 	inode->i_mode = mode;
 	if (S_ISBLK(mode) || S_ISCHR(mode))
-		inode->i_zone[0] = dev;
+		inode->i_zone[0] = rdev;
 	inode->i_mtime = inode->i_atime = CURRENT_TIME;
 	inode->i_dirt = 1;
-	bh = add_entry(dir,basename,namelen,&de);
+	bh = add_entry(dir,name,len,&de);
 	if (!bh) {
-		iput(dir);
 		inode->i_nlinks=0;
 		iput(inode);
 		return -ENOSPC;
 	}
 	de->inode = inode->i_num;
-	bh->b_dirt = 1;
-	iput(dir);
+	journal_dirty(bh);
 	iput(inode);
 	brelse(bh);
 	return 0;
 }
 
-int sys_mkdir(const char * pathname, int mode)
+static int minix_mkdir(struct m_inode * dir, const char * name, int len,
+	int mode)
 {
-	const char * basename;
-	int namelen;
-	struct m_inode * dir, * inode;
+	int block;
+	struct m_inode * inode;
 	struct buffer_head * bh, *dir_block;
 	struct dir_entry * de;
 
-	if (!suser())
-		return -EPERM;
-	if (!(dir = dir_namei(pathname,&namelen,&basename)))
-		return -ENOENT;
-	if (!namelen) {
-		iput(dir);
-		return -ENOENT;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EPERM;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
+	bh = find_entry(dir,name,len,&de,NULL);
 	if (bh) {
 		brelse(bh);
-		iput(dir);
 		return -EEXIST;
 	}
-	inode = new_inode(dir->i_dev);
-	if (!inode) {
-		iput(dir);
+	inode = new_inode(dir->i_dev,dir->i_num);
+	if (!inode)
 		return -ENOSPC;
-	}
 	inode->i_size = 32;
 	inode->i_dirt = 1;
 	inode->i_mtime = inode->i_atime = CURRENT_TIME;
-	if (!(inode->i_zone[0]=new_block(inode->i_dev))) {
-		iput(dir);
+	if (!(block=create_block(inode,0))) {
 		inode->i_nlinks--;
 		iput(inode);
 		return -ENOSPC;
 	}
 	inode->i_dirt = 1;
-	if (!(dir_block=bread(inode->i_dev,inode->i_zone[0]))) {
-		iput(dir);
+	if (!(dir_block=bread(inode->i_dev,block))) {
 		free_block(inode->i_dev,inode->i_zone[0]);
 		inode->i_nlinks--;
 		iput(inode);
@@ -604,23 +370,21 @@ int sys_mkdir(const char * pathname, int mode)
 	de->inode = dir->i_num;
 	strcpy(de->name,"..");
 	inode->i_nlinks = 2;
-	dir_block->b_dirt = 1;
+	journal_dirty(dir_block);
 	brelse(dir_block);
 	inode->i_mode = I_DIRECTORY | (mode & 0777 & ~current->umask);
 	inode->i_dirt = 1;
-	bh = add_entry(dir,basename,namelen,&de);
+	bh = add_entry(dir,name,len,&de);
 	if (!bh) {
-		iput(dir);
 		free_block(inode->i_dev,inode->i_zone[0]);
 		inode->i_nlinks=0;
 		iput(inode);
 		return -ENOSPC;
 	}
 	de->inode = inode->i_num;
-	bh->b_dirt = 1;
+	journal_dirty(bh);
 	dir->i_nlinks++;
 	dir->i_dirt = 1;
-	iput(dir);
 	iput(inode);
 	brelse(bh);
 	return 0;
@@ -637,8 +401,8 @@ static int empty_dir(struct m_inode * inode)
 	struct dir_entry * de;
 
 	len = inode->i_size / sizeof (struct dir_entry);
-	if (len<2 || !inode->i_zone[0] ||
-	    !(bh=bread(inode->i_dev,inode->i_zone[0]))) {
+	if (len<2 || !(block=bmap(inode,0)) ||
+	    !(bh=bread(inode->i_dev,block))) {
 	    	printk("warning - bad directory on dev %04x\n",inode->i_dev);
 		return 0;
 	}
@@ -673,78 +437,58 @@ static int empty_dir(struct m_inode * inode)
 	return 1;
 }
 
-int sys_rmdir(const char * name)
+static int minix_rmdir(struct m_inode * dir, const char * name, int len)
 {
-	const char * basename;
-	int namelen;
-	struct m_inode * dir, * inode;
+	struct m_inode * inode;
 	struct buffer_head * bh;
 	struct dir_entry * de;
+	int nr;
 
-	if (!suser())
-		return -EPERM;
-	if (!(dir = dir_namei(name,&namelen,&basename)))
-		return -ENOENT;
-	if (!namelen) {
-		iput(dir);
+	bh = find_entry(dir,name,len,&de,&nr);
+	if (!bh)
 		return -ENOENT;
+	if (!(inode = iget(dir->i_dev, de->inode))) {
+		brelse(bh);
+		return -EPERM;
 	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EPERM;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (!bh) {
-		iput(dir);
-		return -ENOENT;
-	}
-	if (!(inode = iget(dir->i_dev, de->inode))) {
-		iput(dir);
-		brelse(bh);
-		return -EPERM;
-	}
-	if ((dir->i_mode & S_ISVTX) && current->euid &&
-	    inode->i_uid != current->euid) {
-		iput(dir);
-		iput(inode);
-		brelse(bh);
+	if ((dir->i_mode & S_ISVTX) && current->euid &&
+	    inode->i_uid != current->euid) {
+		iput(inode);
+		brelse(bh);
 		return -EPERM;
 	}
 	if (inode->i_dev != dir->i_dev || inode->i_count>1) {
-		iput(dir);
 		iput(inode);
 		brelse(bh);
 		return -EPERM;
 	}
 	if (inode == dir) {	/* we may not delete ".", but "../dir" is ok */
 		iput(inode);
-		iput(dir);
 		brelse(bh);
 		return -EPERM;
 	}
 	if (!S_ISDIR(inode->i_mode)) {
 		iput(inode);
-		iput(dir);
 		brelse(bh);
 		return -ENOTDIR;
 	}
 	if (!empty_dir(inode)) {
 		iput(inode);
-		iput(dir);
 		brelse(bh);
 		return -ENOTEMPTY;
 	}
 	if (inode->i_nlinks != 2)
 		printk("empty directory has nlink!=2 (%d)",inode->i_nlinks);
 	de->inode = 0;
-	bh->b_dirt = 1;
+	if (nr < dir->i_dfree)
+		dir->i_dfree = nr;
+	journal_dirty(bh);
 	brelse(bh);
 	inode->i_nlinks=0;
 	inode->i_dirt=1;
 	dir->i_nlinks--;
 	dir->i_ctime = dir->i_mtime = CURRENT_TIME;
 	dir->i_dirt=1;
-	iput(dir);
 	iput(inode);
 	return 0;
 }
@@ -752,34 +496,19 @@ int sys_rmdir(const char * name)
 //删除文件名对应的目录项
 //从文件系统删除一个名字,如果是文件的最后一个链接,并且美誉进程正打开该文件
 //则该文件也将被删除,并释放所占用的设备空间
-int sys_unlink(const char * name)
+static int minix_unlink(struct m_inode * dir, const char * name, int len)
 {
-	const char * basename;
-	int namelen;
-	struct m_inode * dir, * inode;
+	struct m_inode * inode;
 	struct buffer_head * bh;
 	struct dir_entry * de;
+	int nr;
 
-	//首先检查参数的有效性并取路径名中顶层目录的i节点
-	if (!(dir = dir_namei(name,&namelen,&basename)))
-		return -ENOENT;
-	if (!namelen) {
-		iput(dir);
-		return -ENOENT;
-	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		return -EPERM;
-	}
-	//然后根据指定目录的i节点和目录名利用函数find_entry()寻找对应目录项
+	//根据指定目录的i节点和目录名利用函数find_entry()寻找对应目录项
 	//再根据该目录项de的i节点号利用iget()函数得到对应的i节点node
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (!bh) {
-		iput(dir);
+	bh = find_entry(dir,name,len,&de,&nr);
+	if (!bh)
 		return -ENOENT;
-	}
 	if (!(inode = iget(dir->i_dev, de->inode))) {
-		iput(dir);
 		brelse(bh);
 		return -ENOENT;
 	}
@@ -787,7 +516,6 @@ int sys_unlink(const char * name)
 	if ((dir->i_mode & S_ISVTX) && !suser() &&
 	    current->euid != inode->i_uid &&
 	    current->euid != dir->i_uid) {
-		iput(dir);
 		iput(inode);
 		brelse(bh);
 		return -EPERM;
@@ -795,10 +523,15 @@ int sys_unlink(const char * name)
 	//如果该文件名是一个目录,则也不能删除
 	if (S_ISDIR(inode->i_mode)) {
 		iput(inode);
-		iput(dir);
 		brelse(bh);
 		return -EPERM;
 	}
+	//正在使用的日志文件也不能删除
+	if (is_journal(inode)) {
+		iput(inode);
+		brelse(bh);
+		return -EBUSY;
+	}
 	//如果该i节点的链接计数值已经为0,则显示警告信息,并修正其为1
 	if (!inode->i_nlinks) {
 		printk("Deleting nonexistent file (%04x:%d), %d\n",
@@ -808,24 +541,437 @@ int sys_unlink(const char * name)
 	//现在我们可以删除文件名目录项了
 	//将文件名目录项中的i节点号字段置0,表示释放该目录项 
 	//并设置包含该目录项的缓冲块已修改标志,释放该高速缓冲块
+	//空出的目录项可能是目录中最低的空闲项
 	de->inode = 0;
-	bh->b_dirt = 1;
+	if (nr < dir->i_dfree)
+		dir->i_dfree = nr;
+	journal_dirty(bh);
 	brelse(bh);
 	inode->i_nlinks--;
 	inode->i_dirt = 1;
 	inode->i_ctime = CURRENT_TIME;
 	iput(inode);
+	return 0;
+}
+
+static int minix_link(struct m_inode * oldinode, struct m_inode * dir,
+	const char * name, int len)
+{
+	struct buffer_head * bh;
+	struct dir_entry * de;
+
+	bh = find_entry(dir,name,len,&de,NULL);
+	if (bh) {
+		brelse(bh);
+		return -EEXIST;
+	}
+	bh = add_entry(dir,name,len,&de);
+	if (!bh)
+		return -ENOSPC;
+	de->inode = oldinode->i_num;
+	journal_dirty(bh);
+	brelse(bh);
+	oldinode->i_nlinks++;
+	oldinode->i_ctime = CURRENT_TIME;
+	oldinode->i_dirt = 1;
+	return 0;
+}
+
+extern int file_read(struct m_inode * inode, struct file * filp,
+		char * buf, int count);
+extern int file_write(struct m_inode * inode, struct file * filp,
+		char * buf, int count);
+extern int minix_readpage(struct m_inode * inode, unsigned long off,
+		unsigned long page);
+extern void minix_writepage(struct m_inode * inode, unsigned long off,
+		unsigned long page);
+extern int minix_fsync(struct m_inode * inode, int datasync);
+extern void minix_readahead(struct m_inode * inode, unsigned long off,
+		int pages);
+
+struct inode_operations minix_inode_operations = {
+	minix_lookup,
+	minix_create,
+	minix_mknod,
+	minix_mkdir,
+	minix_rmdir,
+	minix_unlink,
+	minix_link,
+	file_read,
+	file_write,
+	truncate,
+	minix_readpage,
+	minix_writepage,
+	minix_fsync,
+	minix_readahead
+};
+
+/*
+ *	lookup()
+ *
+ * looks up a name in a directory of any file system type, and returns
+ * its inode in res_inode. '..' in a pseudo-root results in a faked '.',
+ * and '..' over a mount-point is looked up in the directory the file
+ * system is mounted on.
+ */
+static int lookup(struct m_inode * dir, const char * name, int len,
+	struct m_inode ** res_inode)
+{
+	struct super_block * sb;
+
+	*res_inode = NULL;
+	if (len==2 && get_fs_byte(name)=='.' && get_fs_byte(name+1)=='.') {
+		if (dir == current->root)
+			len = 1;
+		else if (dir->i_num == ROOT_INO) {
+			sb = get_super(dir->i_dev);
+			if (sb->s_imount)
+				dir = sb->s_imount;
+		}
+	}
+	if (!dir->i_op || !dir->i_op->lookup)
+		return -ENOENT;
+	return dir->i_op->lookup(dir,name,len,res_inode);
+}
+
+/*
+ *	get_dir()
+ *
+ * Getdir traverses the pathname until it hits the topmost directory.
+ * It returns NULL on failure.
+ */
+//该函数根据给出的路径名进行搜索，直到达到最顶端的目录。如果失败返回NULL
+//返回目录或文件的i节点指针
+static struct m_inode * get_dir(const char * pathname)
+{
+	char c;
+	const char * thisname;
+	struct m_inode * inode, * next;
+	int namelen;
+
+	//搜索操作会从当前进程任务结构中设置的根i节点或当前工作目录i节点开始
+	if (!current->root || !current->root->i_count)		//当前进程的根i节点不存在或引用计数为0，则死机
+		panic("No root inode");
+	if (!current->pwd || !current->pwd->i_count)		//当前进程的当前工作目录根i节点不存在或引用计数为0，则死机
+		panic("No cwd inode");
+	//如果用户指定的路径名的第1个字符是'/'，则说明路径名是绝对路径名
+	if ((c=get_fs_byte(pathname))=='/') {
+		inode = current->root;
+		pathname++;
+	//否则若第一个字符是其他字符，则表示给定的是相对路径名，应从进程的当前工作目录开始操作
+	} else if (c)
+		inode = current->pwd;
+	else
+		return NULL;	/* empty name is bad */
+	//i节点引用计数增1
+	inode->i_count++;
+	//然后针对路径名中的各个目录名部分和文件名进行循环处理
+	while (1) {
+		thisname = pathname;
+		//先对当前正在处理的目录名部分(或文件名)的i节点进行有效性判断
+		if (!S_ISDIR(inode->i_mode) || !permission(inode,MAY_EXEC)) {
+			iput(inode);
+			return NULL;
+		}
+		//每当检索到字符串中的'/'字符或者c为'\0'，循环都会跳出
+		for(namelen=0;(c=get_fs_byte(pathname++))&&(c!='/');namelen++)
+			/* nothing */ ;
+		if (!c)
+			return inode;
+		//在当前处理的目录中寻找指定名称的目录项，取得其i节点
+		//然后放回当前目录，以该目录项为当前目录继续循环处理路径名中的下一目录名部分(或文件名)
+		if (lookup(inode,thisname,namelen,&next)) {
+			iput(inode);
+			return NULL;
+		}
+		iput(inode);
+		inode = next;
+	}
+}
+
+/*
+ *	dir_namei()
+ *
+ * dir_namei() returns the inode of the directory of the
+ * specified name, and the name within that directory.
+ */
+//函数返回指定目录名的i节点指针以及在最顶层目录的名称
+static struct m_inode * dir_namei(const char * pathname,
+	int * namelen, const char ** name)
+{
+	char c;
+	const char * basename;
+	struct m_inode * dir;
+
+	//首先取得指定路径名最顶层目录的i节点
+	if (!(dir = get_dir(pathname)))
+		return NULL;
+	basename = pathname;
+	//逐个遍历/dev/tty0字符串，每次循环都将一个字符复制给c，直到字符串结束
+	while (c=get_fs_byte(pathname++))
+		if (c=='/')
+			basename=pathname;
+	*namelen = pathname-basename-1;		//确定tty0名字的长度
+	*name = basename;		//得到tty0中第一个't'字符的地址
+	return dir;		
+}
+
+/*
+ *	namei()
+ *
+ * is used by most simple commands to get the inode of a specified name.
+ * Open, link etc use their own routines, but this is enough for things
+ * like 'chmod' etc.
+ */
+//取指定路径名的i节点
+//参数：pathname-路径名
+//返回：对应的i节点
+struct m_inode * namei(const char * pathname)
+{
+	const char * basename;
+	int namelen;
+	struct m_inode * dir, * inode;
+
+	//首先查找指定路径的最顶层目录的目录名并得到其i节点，若不存在则返回NULL退出
+	if (!(dir = dir_namei(pathname,&namelen,&basename)))
+		return NULL;
+	//如果返回的最顶层名字的长度是0，则表示该路径名以一个目录名为最后一项
+	//因此我们已经找到对应目录的i节点，可以直接返回该i节点退出
+	if (!namelen)			/* special case: '/usr/' etc */
+		return dir;
+	//然后在返回的顶层目录中寻找指定文件名目录项的i节点，并放回目录i节点
+	lookup(dir,basename,namelen,&inode);
 	iput(dir);
+	//修改其被访问时间为当前时间并置已修改标志
+	if (inode) {
+		inode->i_atime=CURRENT_TIME;
+		inode->i_dirt=1;
+	}
+	//最后返回该i节点
+	return inode;
+}
+
+/*
+ *	open_namei()
+ *
+ * namei for open - this is in fact almost the whole open-routine.
+ */
+//open()函数使用的namei函数-这其实几乎是完整的打开文件程序
+//res_inode-返回对应文件路径名的i节点指针
+int open_namei(const char * pathname, int flag, int mode,
+	struct m_inode ** res_inode)
+{
+	const char * basename;
+	int namelen,error;
+	struct m_inode * dir, *inode;
+
+	//首先对函数参数进行合理的处理
+	if ((flag & O_TRUNC) && !(flag & O_ACCMODE))
+		flag |= O_WRONLY;
+	mode &= 0777 & ~current->umask;
+	mode |= I_REGULAR;
+	//然后根据指定的路径名寻找到对应的i节点以及最顶端目录名及其长度
+	if (!(dir = dir_namei(pathname,&namelen,&basename)))
+		return -ENOENT;
+	//此时如果最顶端目录名长度为0(例如'/usr/'这种路径名的情况)
+	//那么若操作不是读写、创建和文件长度截0，则表示是在打开一个目录名文件操作，
+	//于是直接返回该目录的i节点并返回0退出
+	if (!namelen) {			/* special case: '/usr/' etc */
+		if (!(flag & (O_ACCMODE|O_CREAT|O_TRUNC))) {
+			*res_inode=dir;
+			return 0;
+		}
+		//否则说明进程操作非法，于是放回i节点并返回出错码
+		iput(dir);
+		return -EISDIR;
+	}
+	//接着在最顶层目录dir中查找路径名字字符串中最后的文件名
+	error = lookup(dir,basename,namelen,&inode);
+	//如果没有找到对应文件名的目录项，则只可能是创建文件操作
+	if (error == -ENOENT) {
+		//如果不是创建文件，则放回该目录的i节点，返回出错号退出
+		if (!(flag & O_CREAT)) {
+			iput(dir);
+			return -ENOENT;
+		}
+		//只读文件系统上不能建立文件
+		if (IS_RDONLY(dir)) {
+			iput(dir);
+			return -EROFS;
+		}
+		//如果用户在该目录没有写的权力，则放回该目录的i节点，返回出错号退出
+		if (!permission(dir,MAY_WRITE)) {
+			iput(dir);
+			return -EACCES;
+		}
+		//现在确定是创建文件并有写操作许可，由目录所在文件系统建立文件
+		journal_start(dir->i_dev);
+		error = dir->i_op->create(dir,basename,namelen,mode,&inode);
+		journal_stop(dir->i_dev);
+		iput(dir);
+		if (error)
+			return error;
+		//返回新文件的i节点指针
+		*res_inode = inode;
+		return 0;
+	}
+	//放回目录的i节点
+	iput(dir);
+	if (error)
+		return error;
+	if (flag & O_EXCL) {
+		iput(inode);
+		return -EEXIST;
+	}
+	if ((S_ISDIR(inode->i_mode) && (flag & O_ACCMODE)) ||
+	    !permission(inode,ACC_MODE(flag))) {
+		iput(inode);
+		return -EPERM;
+	}
+	//只读文件系统上的普通文件不能以写方式打开或截断(设备文件除外)
+	if ((flag & (O_ACCMODE|O_TRUNC)) && IS_RDONLY(inode) &&
+	    (S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode))) {
+		iput(inode);
+		return -EROFS;
+	}
+	//日志文件的块号记在日志结构中，使用期间不能写也不能截断
+	if ((flag & (O_ACCMODE|O_TRUNC)) && is_journal(inode)) {
+		iput(inode);
+		return -ETXTBSY;
+	}
+	//接着我们更新该i节点的访问时间字段值为当前时间
+	inode->i_atime = CURRENT_TIME;
+	if (flag & O_TRUNC) {
+		invalidate_pages(inode->i_dev,inode->i_num);
+		journal_start(inode->i_dev);
+		inode->i_op->truncate(inode);
+		journal_stop(inode->i_dev);
+	}
+	//返回该目录项i节点的指针
+	*res_inode = inode;
 	return 0;
 }
 
+int sys_mknod(const char * filename, int mode, int dev)
+{
+	const char * basename;
+	int namelen,error;
+	struct m_inode * dir;
+	
+	if (!suser())
+		return -EPERM;
+	if (!(dir = dir_namei(filename,&namelen,&basename)))
+		return -ENOENT;
+	if (!namelen) {
+		iput(dir);
+		return -ENOENT;
+	}
+	if (IS_RDONLY(dir)) {
+		iput(dir);
+		return -EROFS;
+	}
+	if (!permission(dir,MAY_WRITE)) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start(dir->i_dev);
+	error = dir->i_op->mknod(dir,basename,namelen,mode,dev);
+	journal_stop(dir->i_dev);
+	iput(dir);
+	return error;
+}
+
+int sys_mkdir(const char * pathname, int mode)
+{
+	const char * basename;
+	int namelen,error;
+	struct m_inode * dir;
+
+	if (!suser())
+		return -EPERM;
+	if (!(dir = dir_namei(pathname,&namelen,&basename)))
+		return -ENOENT;
+	if (!namelen) {
+		iput(dir);
+		return -ENOENT;
+	}
+	if (IS_RDONLY(dir)) {
+		iput(dir);
+		return -EROFS;
+	}
+	if (!permission(dir,MAY_WRITE)) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start(dir->i_dev);
+	error = dir->i_op->mkdir(dir,basename,namelen,mode);
+	journal_stop(dir->i_dev);
+	iput(dir);
+	return error;
+}
+
+int sys_rmdir(const char * name)
+{
+	const char * basename;
+	int namelen,error;
+	struct m_inode * dir;
+
+	if (!suser())
+		return -EPERM;
+	if (!(dir = dir_namei(name,&namelen,&basename)))
+		return -ENOENT;
+	if (!namelen) {
+		iput(dir);
+		return -ENOENT;
+	}
+	if (IS_RDONLY(dir)) {
+		iput(dir);
+		return -EROFS;
+	}
+	if (!permission(dir,MAY_WRITE)) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start(dir->i_dev);
+	error = dir->i_op->rmdir(dir,basename,namelen);
+	journal_stop(dir->i_dev);
+	iput(dir);
+	return error;
+}
+
+int sys_unlink(const char * name)
+{
+	const char * basename;
+	int namelen,error;
+	struct m_inode * dir;
+
+	//首先检查参数的有效性并取路径名中顶层目录的i节点
+	if (!(dir = dir_namei(name,&namelen,&basename)))
+		return -ENOENT;
+	if (!namelen) {
+		iput(dir);
+		return -ENOENT;
+	}
+	if (IS_RDONLY(dir)) {
+		iput(dir);
+		return -EROFS;
+	}
+	if (!permission(dir,MAY_WRITE)) {
+		iput(dir);
+		return -EPERM;
+	}
+	journal_start(dir->i_dev);
+	error = dir->i_op->unlink(dir,basename,namelen);
+	journal_stop(dir->i_dev);
+	iput(dir);
+	return error;
+}
+
 int sys_link(const char * oldname, const char * newname)
 {
-	struct dir_entry * de;
 	struct m_inode * oldinode, * dir;
-	struct buffer_head * bh;
 	const char * basename;
-	int namelen;
+	int namelen,error;
 
 	oldinode=namei(oldname);
 	if (!oldinode)
@@ -849,31 +995,20 @@ int sys_link(const char * oldname, const char * newname)
 		iput(oldinode);
 		return -EXDEV;
 	}
-	if (!permission(dir,MAY_WRITE)) {
-		iput(dir);
-		iput(oldinode);
-		return -EACCES;
-	}
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (bh) {
-		brelse(bh);
+	if (IS_RDONLY(dir)) {
 		iput(dir);
 		iput(oldinode);
-		return -EEXIST;
+		return -EROFS;
 	}
-	bh = add_entry(dir,basename,namelen,&de);
-	if (!bh) {
+	if (!permission(dir,MAY_WRITE)) {
 		iput(dir);
 		iput(oldinode);
-		return -ENOSPC;
+		return -EACCES;
 	}
-	de->inode = oldinode->i_num;
-	bh->b_dirt = 1;
-	brelse(bh);
+	journal_start(dir->i_dev);
+	error = dir->i_op->link(oldinode,dir,basename,namelen);
+	journal_stop(dir->i_dev);
 	iput(dir);
-	oldinode->i_nlinks++;
-	oldinode->i_ctime = CURRENT_TIME;
-	oldinode->i_dirt = 1;
 	iput(oldinode);
-	return 0;
+	return error;
 }
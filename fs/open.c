@@ -10,15 +10,55 @@
 #include <sys/types.h>
 #include <utime.h>
 #include <sys/stat.h>
+#include <sys/vfs.h>
 
 #include <linux/sched.h>
 #include <linux/tty.h>
 #include <linux/kernel.h>
 #include <asm/segment.h>
 
+//取已安装文件系统的空闲块数和空闲i节点数
+//这些计数保存在超级块中，因此不需要扫描位图
 int sys_ustat(int dev, struct ustat * ubuf)
 {
-	return -ENOSYS;
+	struct super_block * sb;
+	struct ustat tmp;
+	int i;
+
+	if (!(sb = get_super(dev)))
+		return -EINVAL;
+	verify_area(ubuf,sizeof (* ubuf));
+	tmp.f_tfree = sb->s_zfree - sb->s_zdelay;
+	tmp.f_tinode = sb->s_ifree;
+	for (i=0 ; i<6 ; i++)
+		tmp.f_fname[i] = tmp.f_fpack[i] = 0;
+	memcpy_tofs(ubuf,&tmp,sizeof (tmp));
+	return 0;
+}
+
+//取路径名所在文件系统的统计信息
+int sys_statfs(const char * filename, struct statfs * buf)
+{
+	struct m_inode * inode;
+	struct super_block * sb;
+	struct statfs tmp;
+
+	if (!(inode=namei(filename)))
+		return -ENOENT;
+	sb = get_super(inode->i_dev);
+	iput(inode);
+	if (!sb)
+		return -EINVAL;
+	verify_area(buf,sizeof (* buf));
+	tmp.f_type = sb->s_magic;
+	tmp.f_bsize = BLOCK_SIZE << sb->s_log_zone_size;
+	tmp.f_blocks = sb->s_zones - sb->s_firstdatazone;
+	tmp.f_bfree = sb->s_zfree - sb->s_zdelay;
+	tmp.f_files = sb->s_ninodes;
+	tmp.f_ffree = sb->s_ifree;
+	tmp.f_namelen = NAME_LEN;
+	memcpy_tofs(buf,&tmp,sizeof (tmp));
+	return 0;
 }
 
 int sys_utime(char * filename, struct utimbuf * times)
@@ -28,6 +68,10 @@ int sys_utime(char * filename, struct utimbuf * times)
 
 	if (!(inode=namei(filename)))
 		return -ENOENT;
+	if (IS_RDONLY(inode)) {
+		iput(inode);
+		return -EROFS;
+	}
 	if (times) {
 		actime = get_fs_long((unsigned long *) &times->actime);
 		modtime = get_fs_long((unsigned long *) &times->modtime);
@@ -108,6 +152,10 @@ int sys_chmod(const char * filename,int mode)
 
 	if (!(inode=namei(filename)))
 		return -ENOENT;
+	if (IS_RDONLY(inode)) {
+		iput(inode);
+		return -EROFS;
+	}
 	if ((current->euid != inode->i_uid) && !suser()) {
 		iput(inode);
 		return -EACCES;
@@ -124,6 +172,10 @@ int sys_chown(const char * filename,int uid,int gid)
 
 	if (!(inode=namei(filename)))
 		return -ENOENT;
+	if (IS_RDONLY(inode)) {
+		iput(inode);
+		return -EROFS;
+	}
 	if (!suser()) {
 		iput(inode);
 		return -EACCES;
@@ -146,29 +198,19 @@ int sys_open(const char * filename,int flag,int mode)
 
 	//将用户设置的文件模式和进程模式屏蔽码相与，产生许可的文件模式
 	mode &= 0777 & ~current->umask;
-	//搜索进程结构中文件结构指针数组，以查找一个空闲项
-	//空闲项的索引号fd即是句柄值
-	for(fd=0 ; fd<NR_OPEN ; fd++)
-		if (!current->filp[fd])
-			break;
-	if (fd>=NR_OPEN)
-		return -EINVAL;
-	//设置当前进程的执行时关闭文件句柄位图，复位对应的比特位
-	current->close_on_exec &= ~(1<<fd);
-	//然后为打开文件在文件表中寻找一个空闲结构项
-	//令f指向文件表数组开始处，搜索空闲文件结构项(引用计数为0的项)
-	f=0+file_table;
-	for (i=0 ; i<NR_FILE ; i++,f++)
-		if (!f->f_count) break;
-	if (i>=NR_FILE)
-		return -EINVAL;
-	//让进程对应文件句柄fd的文件结构指针指向搜索到的文件结构，并令文件引用计数递增1
-	(current->filp[fd]=f)->f_count++;
+	//取一个空闲的文件句柄(最小的未用句柄)，句柄表满时会自动扩展
+	if ((fd=get_unused_fd(0))<0)
+		return fd;
+	//然后为打开文件取一个空闲的文件结构，其引用计数已置为1
+	if (!(f=get_empty_filp()))
+		return -ENFILE;
+	//让进程对应文件句柄fd的文件结构指针指向取得的文件结构
+	current->filp[fd]=f;
 	//执行打开操作，若返回值小于0，则说明出错，于是释放刚申请到的文件结构，返回出错码i
 	//若文件打开操作成功，则inode是已打开文件的i节点指针
 	if ((i=open_namei(filename,flag,mode,&inode))<0) {
 		current->filp[fd]=NULL;
-		f->f_count=0;
+		put_filp(f);
 		return i;
 	}
 /* ttys are somewhat special (ttyxx major==4, tty major==5) */
@@ -189,7 +231,7 @@ int sys_open(const char * filename,int flag,int mode)
 			if (current->tty<0) {
 				iput(inode);
 				current->filp[fd]=NULL;
-				f->f_count=0;
+				put_filp(f);
 				return -EPERM;
 			}
 /* Likewise with block-devices: check for floppy_change */
@@ -200,7 +242,6 @@ int sys_open(const char * filename,int flag,int mode)
 	//初始化打开文件的文件结构
 	f->f_mode = inode->i_mode;	//用该i节点属性，设置文件属性
 	f->f_flags = flag;				//用flag参数，设置文件标识
-	f->f_count = 1;					//将文件引用计数加1
 	f->f_inode = inode;				//文件与i节点建立关系
 	f->f_pos = 0;						//将文件读写指针设置为0
 	//返回文件句柄号
@@ -222,13 +263,15 @@ int sys_close(unsigned int fd)
 	struct file * filp;
 
 	//首先检查参数有效性
-	if (fd >= NR_OPEN)
+	if (fd >= current->max_fds)
 		return -EINVAL;
-	current->close_on_exec &= ~(1<<fd);
+	FD_CLOEXEC_CLR(fd);
 	if (!(filp = current->filp[fd]))
 		return -EINVAL;
-	//置该文件句柄的文件结构指针为NULL
+	//置该文件句柄的文件结构指针为NULL，它可能成为最小的空闲句柄
 	current->filp[fd] = NULL;
+	if (fd < current->next_fd)
+		current->next_fd = fd;
 	//若在关闭文件之前，对应文件结构中的句柄要引用计数已经为0
 	//则说明内核出错，停机
 	if (filp->f_count == 0)
@@ -238,7 +281,8 @@ int sys_close(unsigned int fd)
 	if (--filp->f_count)
 		return (0);
 	//如果引用计数已等于0，说明该文件已经没有进程引用，该文件结构已变为空闲
-	//则释放该文件i节点，返回0
+	//则释放该文件i节点和文件结构，返回0
 	iput(filp->f_inode);
+	put_filp(filp);
 	return (0);
 }
@@ -5,92 +5,191 @@
  */
 
 #include <signal.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
 
 #include <linux/sched.h>
 #include <linux/mm.h>	/* for get_free_page */
 #include <asm/segment.h>
 
+extern int sys_close(int fd);
+
+#define PAGE_ALIGNED(x) (!((unsigned long) (x) & (PAGE_SIZE-1)))
+
+/*
+ * Page flipping: a whole, page-aligned page of user data is not copied
+ * into or out of the pipe. A writer's page is shared into the ring slot
+ * copy-on-write; a reader gets the slot's page mapped in place of its own
+ * buffer page, which becomes the new slot page. Only for user-space
+ * buffers (fs = 0x17), not for kernel callers such as sendfile().
+ */
+static int flip_from_user(struct m_inode * inode, int i, char * buf)
+{
+	unsigned long page;
+
+	if (!PAGE_ALIGNED(buf) || get_fs() != 0x17)
+		return 0;
+	if (!(page = get_user_page(current->start_code + (unsigned long) buf)))
+		return 0;
+	free_page(inode->i_pipe_page[i]);
+	inode->i_pipe_page[i] = page;
+	return 1;
+}
+
+static int flip_to_user(struct m_inode * inode, int i, char * buf)
+{
+	unsigned long page;
+
+	if (!PAGE_ALIGNED(buf) || get_fs() != 0x17)
+		return 0;
+	if (!(page = put_user_page(inode->i_pipe_page[i],
+	    current->start_code + (unsigned long) buf)))
+		return 0;
+	inode->i_pipe_page[i] = page;
+	return 1;
+}
+
+//写入管道页面之前，如果该页面还与某个写者共享着(来自flip_from_user())，先复制一份
+static int own_pipe_page(struct m_inode * inode, int i)
+{
+	unsigned long page;
+
+	if (!page_shared(inode->i_pipe_page[i]))
+		return 1;
+	if (!(page = get_free_page()))
+		return 0;
+	memcpy((char *) page,(char *) inode->i_pipe_page[i],PAGE_SIZE);
+	free_page(inode->i_pipe_page[i]);
+	inode->i_pipe_page[i] = page;
+	return 1;
+}
+
 //管道读操作函数
 //参数inode是管道对应的i节点，buf是用户数据缓冲区指针，count是读取的字节数
-int read_pipe(struct m_inode * inode, char * buf, int count)
+//读者和写者都睡眠在i_wait上。写者只在管道由空变为非空时唤醒读者，
+//读者只在空闲空间增长到PIPE_WAKE时唤醒写者，避免每读写几个字节就来回切换
+int read_pipe(struct m_inode * inode, char * buf, int count,
+	unsigned short flags)
 {
-	int chars, size, read = 0;
+	int chars, size, free, read = 0;
 
 	//如果需要读取的字节计数count>0，就循环执行以下操作
 	while (count>0) {
-		//如果当前管道中没有数据(size=0)，则唤醒等待该节点的进程，这通常是写管道进程
+		//如果当前管道中没有数据(size=0)，则在该i节点上睡眠等待写者
 		while (!(size=PIPE_SIZE(*inode))) {
-			wake_up(&inode->i_wait);
 			//如果已没有写管道者，即i节点引用计数值小于2，则返回已读字节数退出
 			if (inode->i_count != 2) /* are there any writers? */
 				return read;
-			//否则在该i节点上睡眠
+			//非阻塞方式：有多少读多少，一点都没有则返回-EAGAIN
+			if (flags & O_NONBLOCK)
+				return read?read:-EAGAIN;
 			sleep_on(&inode->i_wait);
 		}
-		//此时说明管道(缓冲区)中有数据
-		chars = PAGE_SIZE-PIPE_TAIL(*inode);
+		//此时说明管道(缓冲区)中有数据，一次最多读到当前页面的末端
+		chars = PAGE_SIZE-(PIPE_TAIL(*inode)&(PAGE_SIZE-1));
 		if (chars > count)
 			chars = count;
 		if (chars > size)
 			chars = size;
 		count -= chars;
 		read += chars;
+		free = PIPE_FREE(*inode);
 		size = PIPE_TAIL(*inode);
-		PIPE_TAIL(*inode) += chars;
-		PIPE_TAIL(*inode) &= (PAGE_SIZE-1);
-		while (chars-->0)
-			put_fs_byte(((char *)inode->i_size)[size++],buf++);
+		//整页时尽量直接换页，否则复制
+		//复制完才移动尾指针：复制中可能缺页睡眠，尾指针一移动写者就会重用(甚至换掉)这一页
+		if (chars != PAGE_SIZE || !flip_to_user(inode,size>>12,buf))
+			memcpy_tofs(buf,PIPE_ADDR(*inode,size),chars);
+		PIPE_TAIL(*inode) = (size + chars) & (PIPE_BUF_SIZE(*inode)-1);
+		buf += chars;
+		if (free < PIPE_WAKE(*inode) && free+chars >= PIPE_WAKE(*inode))
+			wake_up(&inode->i_wait);
 	}
-	wake_up(&inode->i_wait);
 	return read;
 }
 
 //管道写操作函数
 //参数inode是管道对应的i节点，buf是用户数据缓冲区指针，count是将写入管道的字节数
-int write_pipe(struct m_inode * inode, char * buf, int count)
+int write_pipe(struct m_inode * inode, char * buf, int count,
+	unsigned short flags)
 {
-	int chars, size, written = 0;
+	int chars, size, empty, flipped, written = 0;
 
 	//如果需要写入的字节计数count>0，就循环执行以下操作
 	while (count>0) {
-		//如果当前管道已经满了，则唤醒等待该节点的进程，通常唤醒的是读管道进程
-		while (!(size=(PAGE_SIZE-1)-PIPE_SIZE(*inode))) {
-			wake_up(&inode->i_wait);
+		//管道空闲空间不到min(count,PIPE_WAKE)时就睡眠等待，读者腾出足够空间后会唤醒我们
+		//管道非空时读者不会睡眠，因此这里不必唤醒它们
+		while ((size=PIPE_FREE(*inode)) < count &&
+		       size < PIPE_WAKE(*inode)) {
 			//如果已没有读管道进程，即i节点引用计数值小于2，
 			//则向当前进程发送SIGPIPE信号，并返回已写入的字节数退出
 			if (inode->i_count != 2) { /* no readers */
 				current->signal |= (1<<(SIGPIPE-1));
 				return written?written:-1;
 			}
-			//否则让当前进程在该i节点上睡眠，以等待读管道进程读取数据，从而让管道腾出空间
+			//非阻塞方式：只要还有空闲空间就写入能写下的部分
+			if (flags & O_NONBLOCK) {
+				if (size)
+					break;
+				return written?written:-EAGAIN;
+			}
 			sleep_on(&inode->i_wait);
 		}
 		//程序执行到这里表示管道缓冲区中有可写空间size
-		//取管道头指针到缓冲区末端空间字节数chars，写管道操作是从管道头指针处开始写的
-		chars = PAGE_SIZE-PIPE_HEAD(*inode);
+		//取管道头指针到当前页面末端的字节数chars，写管道操作是从管道头指针处开始写的
+		chars = PAGE_SIZE-(PIPE_HEAD(*inode)&(PAGE_SIZE-1));
 		//如果cahrs大于还需要写入的字节数count，则令其等于count
 		if (chars > count)
 			chars = count;
 		//如果chars大于当前管道中空闲空间长度size，则令其等于size
 		if (chars > size)
 			chars = size;
+		//整页对齐的数据直接把用户页面共享给管道，否则要复制，复制前确保管道页面不再与别人共享
+		flipped = chars == PAGE_SIZE &&
+			flip_from_user(inode,PIPE_HEAD(*inode)>>12,buf);
+		if (!flipped && !own_pipe_page(inode,PIPE_HEAD(*inode)>>12))
+			return written?written:-ENOMEM;
 		//然后把需要写入字节数count减去此次可写入的字节数chars，并把写入自己恩数累加到written中
 		count -= chars;
 		written += chars;
 		//再令size指向管道数据头指针处，并调整当前管道数据头部指针(前移chars字节)
+		empty = PIPE_EMPTY(*inode);
 		size = PIPE_HEAD(*inode);
 		PIPE_HEAD(*inode) += chars;
 		//若头指针差超过管道末端则绕回
-		PIPE_HEAD(*inode) &= (PAGE_SIZE-1);
+		PIPE_HEAD(*inode) &= (PIPE_BUF_SIZE(*inode)-1);
 		//然后从用户缓冲区复制chars个字节到管道头指针开始处
-		while (chars-->0)
-			((char *)inode->i_size)[size++]=get_fs_byte(buf++);
+		if (!flipped)
+			memcpy_fromfs(PIPE_ADDR(*inode,size),buf,chars);
+		buf += chars;
+		//管道原来是空的，可能有读者在等待数据
+		if (empty)
+			wake_up(&inode->i_wait);
 	}
-	//此次写管道操作结束，则唤醒等待管道的进程，返回已写入的字节数
-	wake_up(&inode->i_wait);
 	return written;
 }
 
+//设置管道缓冲区的页面数pages(2的幂，不超过PIPE_MAX_PAGES)
+//只有空管道才能改变容量，这样不必搬移数据，也不会有读写者正在复制的页面被释放
+//缩小容量时多出的页面留到管道关闭时再释放。返回新的缓冲区长度
+int pipe_set_pages(struct m_inode * inode, int pages)
+{
+	int i;
+
+	if (pages < 1 || pages > PIPE_MAX_PAGES || (pages & (pages-1)))
+		return -EINVAL;
+	if (!PIPE_EMPTY(*inode))
+		return -EBUSY;
+	for (i=0 ; i<pages ; i++)
+		if (!inode->i_pipe_page[i] &&
+		    !(inode->i_pipe_page[i]=get_free_page()))
+			return -ENOMEM;
+	PIPE_PAGES(*inode) = pages;
+	PIPE_HEAD(*inode) = PIPE_TAIL(*inode) = 0;
+	wake_up(&inode->i_wait);
+	return PIPE_BUF_SIZE(*inode);
+}
+
 //创建管道系统调用
 //在fildes所指的数组中创建一对文件句柄(描述符)。这对文件句柄指向一管道i节点
 //参数：fildes-文件句柄数组。fildes[0]用于读管道数据，fildes[1]用于向管道写入数据
@@ -99,38 +198,36 @@ int sys_pipe(unsigned long * fildes)
 	struct m_inode * inode;
 	struct file * f[2];		//文件结构数组
 	int fd[2];				//文件句柄数组
-	int i,j;
-
-	//首先从系统文件表中取两个空闲项(引用计数字段为0的项)，并分别设置引用计数为1
-	j=0;
-	for(i=0;j<2 && i<NR_FILE;i++)
-		if (!file_table[i].f_count)
-			(f[j++]=i+file_table)->f_count++;
-	//若只有一个空闲项，则释放该该项(引用计数复位)
-	if (j==1)
-		f[0]->f_count=0;
-	//若没有找到两个空闲项则返回-1
-	if (j<2)
-		return -1;
-	//针对上面取得的两个文件表结构，分别分配一文件句柄号，并使进程文件结构指针数组的两项分别指向这两个文件结构
+	int j;
+
+	//首先取两个空闲文件结构，引用计数都已置为1
+	if (!(f[0]=get_empty_filp()))
+		return -ENFILE;
+	if (!(f[1]=get_empty_filp())) {
+		put_filp(f[0]);
+		return -ENFILE;
+	}
+	//针对上面取得的两个文件结构，分别分配一文件句柄号，并使进程文件结构指针数组的两项分别指向这两个文件结构
 	//文件句柄即该数组的索引号
-	j=0;
-	for(i=0;j<2 && i<NR_OPEN;i++)
-		if (!current->filp[i]) {
-			current->filp[ fd[j]=i ] = f[j];
-			j++;
+	for (j=0 ; j<2 ; j++) {
+		if ((fd[j]=get_unused_fd(0))<0) {
+			if (j)
+				sys_close(fd[0]);
+			else
+				put_filp(f[0]);
+			put_filp(f[1]);
+			return fd[j];
 		}
-	if (j==1)
-		current->filp[fd[0]]=NULL;
-	if (j<2) {
-		f[0]->f_count=f[1]->f_count=0;
-		return -1;
+		current->filp[fd[j]] = f[j];
 	}
 	//然后利用函数get_pipe_inode()申请一个管道使用的i节点，并为管道分配一页内存作为缓冲区
 	if (!(inode=get_pipe_inode())) {
 		current->filp[fd[0]] =
 			current->filp[fd[1]] = NULL;
-		f[0]->f_count = f[1]->f_count = 0;
+		if (fd[0] < current->next_fd)
+			current->next_fd = fd[0];
+		put_filp(f[0]);
+		put_filp(f[1]);
 		return -1;
 	}
 	//如果管道i节点申请成功，则对两个文件结构进行初始化操作，让它们都指向同一个管道i节点，并把读写指针都置零
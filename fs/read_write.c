@@ -6,28 +6,30 @@
 
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
 
 #include <linux/kernel.h>
 #include <linux/sched.h>
 #include <asm/segment.h>
 
-extern int rw_char(int rw,int dev, char * buf, int count, off_t * pos);
-extern int read_pipe(struct m_inode * inode, char * buf, int count);
-extern int write_pipe(struct m_inode * inode, char * buf, int count);
-extern int block_read(int dev, off_t * pos, char * buf, int count);
-extern int block_write(int dev, off_t * pos, char * buf, int count);
+extern int rw_char(int rw,int dev, char * buf, int count, off_t * pos,
+		unsigned short flags);
+extern int read_pipe(struct m_inode * inode, char * buf, int count,
+		unsigned short flags);
+extern int write_pipe(struct m_inode * inode, char * buf, int count,
+		unsigned short flags);
+extern int block_read(int dev, off_t * pos, char * buf, int count, int flags);
+extern int block_write(int dev, off_t * pos, char * buf, int count, int flags);
 extern int file_read(struct m_inode * inode, struct file * filp,
 		char * buf, int count);
-extern int file_write(struct m_inode * inode, struct file * filp,
-		char * buf, int count);
 
 int sys_lseek(unsigned int fd,off_t offset, int origin)
 {
 	struct file * file;
 	int tmp;
 
-	if (fd >= NR_OPEN || !(file=current->filp[fd]) || !(file->f_inode)
+	if (fd >= current->max_fds || !(file=current->filp[fd]) || !(file->f_inode)
 	   || !IS_SEEKABLE(MAJOR(file->f_inode->i_dev)))
 		return -EBADF;
 	if (file->f_inode->i_pipe)
@@ -60,7 +62,7 @@ int sys_read(unsigned int fd,char * buf,int count)
 	struct m_inode * inode;
 
 	//首先对参数有效性进行判断
-	if (fd>=NR_OPEN || count<0 || !(file=current->filp[fd]))
+	if (fd>=current->max_fds || count<0 || !(file=current->filp[fd]))
 		return -EINVAL;
 	if (!count)
 		return 0;
@@ -71,50 +73,165 @@ int sys_read(unsigned int fd,char * buf,int count)
 	//如果是管道文件并且是读管道文件模式，则进行读管道操作，
 	//若成功则返回读取的字节数，否则返回出错码，退出
 	if (inode->i_pipe)
-		return (file->f_mode&1)?read_pipe(inode,buf,count):-EIO;
+		return (file->f_mode&1)?read_pipe(inode,buf,count,file->f_flags):-EIO;
 	//如果是字符型文件，则进行读字符设备操作，并返回读取的字节数
 	if (S_ISCHR(inode->i_mode))
-		return rw_char(READ,inode->i_zone[0],buf,count,&file->f_pos);
+		return rw_char(READ,inode->i_zone[0],buf,count,&file->f_pos,
+			file->f_flags);
 	//如果是块设备文件，则执行块设备读操作，并返回读取的字节数
 	if (S_ISBLK(inode->i_mode))
-		return block_read(inode->i_zone[0],&file->f_pos,buf,count);
+		return block_read(inode->i_zone[0],&file->f_pos,buf,count,
+			file->f_flags);
 	//如果是目录文件或者普通文件，则首先验证读取字节数count的有效性并进行调整
 	if (S_ISDIR(inode->i_mode) || S_ISREG(inode->i_mode)) {
 		if (count+file->f_pos > inode->i_size)
 			count = inode->i_size - file->f_pos;
 		if (count<=0)
 			return 0;
-		//执行文件读操作，返回读取的字节数并退出
-		return file_read(inode,file,buf,count);
+		//由文件所在文件系统执行读操作，返回读取的字节数并退出
+		return inode->i_op->read(inode,file,buf,count);
 	}
 	//执行到这里，说明我们无法判断文件的属性，则打印节点文件属性并返回出错码退出
 	printk("(Read)inode->i_mode=%06o\n\r",inode->i_mode);
 	return -EINVAL;
 }
 
+//按输出文件的类型调用相应的写函数，buf在fs段中
+static int write_file(struct file * file,char * buf,int count)
+{
+	struct m_inode * inode;
+
+	//取文件i节点
+	inode=file->f_inode;
+	if (inode->i_pipe)
+		return (file->f_mode&2)?write_pipe(inode,buf,count,file->f_flags):-EIO;
+	if (S_ISCHR(inode->i_mode))
+		return rw_char(WRITE,inode->i_zone[0],buf,count,&file->f_pos,
+			file->f_flags);
+	if (S_ISBLK(inode->i_mode))
+		return block_write(inode->i_zone[0],&file->f_pos,buf,count,
+			file->f_flags);
+	//若是常规文件，则执行文件写操作，并返回写入的字节数，退出
+	//写普通文件可能分配磁盘块，是一次元数据修改操作
+	//页面缓存中该文件的页就此作废。写的过程中可能睡眠，别的进程可能
+	//在此期间又把旧内容读进了页面缓存，所以写完后要再作废一次
+	if (S_ISREG(inode->i_mode)) {
+		invalidate_pages(inode->i_dev,inode->i_num);
+		journal_start(inode->i_dev);
+		count = inode->i_op->write(inode,file,buf,count);
+		journal_stop(inode->i_dev);
+		invalidate_pages(inode->i_dev,inode->i_num);
+		return count;
+	}
+	printk("(Write)inode->i_mode=%06o\n\r",inode->i_mode);
+	return -EINVAL;
+}
+
 //写文件系统调用
 //参数fd是文件句柄，buf是缓冲区，count是欲写字节数
 int sys_write(unsigned int fd,char * buf,int count)
 {
 	struct file * file;
-	struct m_inode * inode;
 	
 	//首先对参数有效性进行判断
-	if (fd>=NR_OPEN || count <0 || !(file=current->filp[fd]))
+	if (fd>=current->max_fds || count <0 || !(file=current->filp[fd]))
 		return -EINVAL;
 	if (!count)
 		return 0;
-	//然后取文件i节点
-	inode=file->f_inode;
-	if (inode->i_pipe)
-		return (file->f_mode&2)?write_pipe(inode,buf,count):-EIO;
-	if (S_ISCHR(inode->i_mode))
-		return rw_char(WRITE,inode->i_zone[0],buf,count,&file->f_pos);
-	if (S_ISBLK(inode->i_mode))
-		return block_write(inode->i_zone[0],&file->f_pos,buf,count);
-	//若是常规文件，则执行文件写操作，并返回写入的字节数，退出
-	if (S_ISREG(inode->i_mode))
-		return file_write(inode,file,buf,count);
-	printk("(Write)inode->i_mode=%06o\n\r",inode->i_mode);
-	return -EINVAL;
+	return write_file(file,buf,count);
+}
+
+/*
+ * For files not kept in the buffer cache sendfile() copies through a
+ * page, using the read operation of the input file.
+ */
+static int copy_file(struct file * in, struct file * out, int count)
+{
+	struct m_inode * inode = in->f_inode;
+	unsigned long old_fs, page;
+	int chars,n=0,written=0;
+
+	if (!(page = get_free_page()))
+		return -ENOMEM;
+	old_fs = get_fs();
+	set_fs(get_ds());
+	while (count>0) {
+		chars = (count < PAGE_SIZE) ? count : PAGE_SIZE;
+		if ((n = inode->i_op->read(inode,in,(char *) page,chars)) <= 0)
+			break;
+		chars = n;
+		n = write_file(out,(char *) page,chars);
+		//没写出去的部分退回输入文件
+		in->f_pos -= chars - (n>0 ? n : 0);
+		if (n<=0)
+			break;
+		written += n;
+		count -= n;
+		if (n<chars)
+			break;
+	}
+	set_fs(old_fs);
+	free_page(page);
+	return written?written:n;
+}
+
+/*
+ * sendfile() copies count bytes from in_fd, starting at its current file
+ * position, to out_fd without going through user space: each block is
+ * taken from the buffer cache and handed to the output's write routine
+ * with fs pointing at kernel data. There is no room in int 0x80 for an
+ * offset argument, so lseek() in_fd first; its position is advanced.
+ */
+int sys_sendfile(unsigned int out_fd,unsigned int in_fd,int count)
+{
+	static char zero_block[BLOCK_SIZE];
+	struct file * in, * out;
+	struct m_inode * inode;
+	struct buffer_head * bh;
+	unsigned long old_fs;
+	int nr,chars,written=0,n=0;
+	char * p;
+
+	if (out_fd>=current->max_fds || in_fd>=current->max_fds || count<0 ||
+	    !(out=current->filp[out_fd]) || !(in=current->filp[in_fd]))
+		return -EINVAL;
+	inode = in->f_inode;
+	//输入只支持普通文件
+	if (!S_ISREG(inode->i_mode) || (in->f_flags & O_ACCMODE) == O_WRONLY)
+		return -EINVAL;
+	if (count+in->f_pos > inode->i_size)
+		count = inode->i_size - in->f_pos;
+	if (count<=0)
+		return 0;
+	if (inode->i_op->read != file_read)
+		return copy_file(in,out,count);
+	old_fs = get_fs();
+	set_fs(get_ds());
+	while (count>0) {
+		//与file_read()一样，先找延迟写的数据块，再找磁盘上的块，文件空洞读出0
+		if (bh = get_delayed(inode,(in->f_pos)/BLOCK_SIZE,0))
+			;
+		else if (nr = bmap(inode,(in->f_pos)/BLOCK_SIZE)) {
+			if (!(bh=bread_zone(inode->i_dev,nr))) {
+				n = -EIO;
+				break;
+			}
+		} else
+			bh = NULL;
+		nr = in->f_pos % BLOCK_SIZE;
+		chars = (BLOCK_SIZE-nr < count) ? BLOCK_SIZE-nr : count;
+		p = nr + (bh ? bh->b_data : zero_block);
+		n = write_file(out,p,chars);
+		brelse(bh);
+		if (n<=0)
+			break;
+		in->f_pos += n;
+		written += n;
+		count -= n;
+		if (n<chars)
+			break;
+	}
+	set_fs(old_fs);
+	inode->i_atime = CURRENT_TIME;
+	return written?written:n;
 }
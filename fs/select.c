@@ -0,0 +1,334 @@
+/*
+ *  linux/fs/select.c
+ */
+
+/*
+ * select() and poll(). Only pipes and ttys can make a caller wait: all
+ * other files are always ready. The waiting task is pushed on the wait
+ * queue of every descriptor it looks at (i_wait of a pipe, proc_list of
+ * a tty queue), so any of the usual wake_up()s there wakes it.
+ */
+
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/poll.h>
+
+#include <linux/sched.h>
+#include <linux/tty.h>
+#include <linux/kernel.h>
+#include <asm/segment.h>
+
+typedef struct {
+	struct task_struct * old_task;
+	struct task_struct ** wait_address;
+} wait_entry;
+
+/*
+ * With NR_OPEN descriptors the tables no longer fit on the kernel stack,
+ * so select_table and poll's copy of the pollfds each take a page.
+ */
+#define MAX_WAIT ((PAGE_SIZE-sizeof(int))/sizeof(wait_entry))
+#define MAX_POLL (PAGE_SIZE/sizeof(struct pollfd))
+
+typedef struct {
+	int nr;
+	wait_entry entry[MAX_WAIT];
+} select_table;
+
+//把当前进程放到等待队列wait_address的头上，记下原来的队头
+static void add_wait(struct task_struct ** wait_address, select_table * p)
+{
+	int i;
+
+	if (!wait_address)
+		return;
+	for (i = 0 ; i < p->nr ; i++)
+		if (p->entry[i].wait_address == wait_address)
+			return;
+	if (p->nr >= MAX_WAIT)
+		return;
+	p->entry[p->nr].wait_address = wait_address;
+	p->entry[p->nr].old_task = *wait_address;
+	*wait_address = current;
+	p->nr++;
+}
+
+/*
+ * Take current off the wait queues again. If we are still at the head
+ * the old head is put back. If the queue was woken (wake_up() leaves it
+ * NULL), the old head must be woken too, as sleep_on() would have. If
+ * somebody slept on top of us, we cannot unlink ourselves: wake the old
+ * head now so it is not lost, it rechecks its condition anyway.
+ */
+static void free_wait(select_table * p)
+{
+	int i;
+	struct task_struct ** tpp;
+
+	for (i = 0 ; i < p->nr ; i++) {
+		tpp = p->entry[i].wait_address;
+		if (*tpp == current)
+			*tpp = p->entry[i].old_task;
+		else if (p->entry[i].old_task)
+			p->entry[i].old_task->state = TASK_RUNNING;
+	}
+	p->nr = 0;
+}
+
+//取i节点对应的终端，不是终端则返回NULL
+static struct tty_struct * get_tty(struct m_inode * inode)
+{
+	int major, minor;
+
+	if (!S_ISCHR(inode->i_mode))
+		return NULL;
+	if ((major = MAJOR(inode->i_zone[0])) != 5 && major != 4)
+		return NULL;
+	if (major == 5)
+		minor = current->tty;
+	else
+		minor = MINOR(inode->i_zone[0]);
+	if (minor < 0 || minor > 2)
+		return NULL;
+	return tty_table + minor;
+}
+
+//文件是否可读(读操作不会阻塞)。不可读时把当前进程加入相应的等待队列
+//条件与read_pipe()和tty_read()中睡眠的条件一致
+static int check_in(select_table * wait, struct m_inode * inode)
+{
+	struct tty_struct * tty;
+
+	if (tty = get_tty(inode)) {
+		if (!EMPTY(tty->secondary) && (!(tty->termios.c_lflag & ICANON) ||
+		    tty->secondary.data || LEFT(tty->secondary) <= 20))
+			return 1;
+		add_wait(&tty->secondary.proc_list, wait);
+	} else if (inode->i_pipe) {
+		if (!PIPE_EMPTY(*inode) || inode->i_count != 2)
+			return 1;
+		add_wait(&inode->i_wait, wait);
+	} else
+		return 1;
+	return 0;
+}
+
+//文件是否可写
+static int check_out(select_table * wait, struct m_inode * inode)
+{
+	struct tty_struct * tty;
+
+	if (tty = get_tty(inode)) {
+		if (!FULL(tty->write_q))
+			return 1;
+		add_wait(&tty->write_q.proc_list, wait);
+	} else if (inode->i_pipe) {
+		//与write_pipe()的睡眠条件一致：空闲空间要到PIPE_WAKE，读者也正是在这时唤醒写者
+		if (PIPE_FREE(*inode) >= PIPE_WAKE(*inode) || inode->i_count != 2)
+			return 1;
+		add_wait(&inode->i_wait, wait);
+	} else
+		return 1;
+	return 0;
+}
+
+/*
+ * Sleep until woken or until the timeout set in current->timeout has
+ * passed. Returns 0 if the caller should stop waiting.
+ */
+static int select_wait(select_table * wait, int timed)
+{
+	if (!wait->nr && !timed)
+		return 0;
+	if (current->signal & ~current->blocked)
+		return 0;
+	if (timed && !current->timeout)
+		return 0;
+	schedule();
+	return 1;
+}
+
+static int do_select(int n, fd_set * in, fd_set * out, int timed)
+{
+	select_table * wait;
+	fd_set res_in, res_out;
+	struct file * file;
+	int i,count;
+
+	if (!(wait = (select_table *) get_free_page()))
+		return -ENOMEM;
+	for (;;) {
+		//先置为可中断睡眠状态再检查，检查期间的唤醒不会丢失
+		current->state = TASK_INTERRUPTIBLE;
+		wait->nr = 0;
+		count = 0;
+		FD_ZERO(&res_in);
+		FD_ZERO(&res_out);
+		for (i = 0 ; i < n ; i++) {
+			if (!FD_ISSET(i,in) && !FD_ISSET(i,out))
+				continue;
+			file = current->filp[i];
+			if (FD_ISSET(i,in) && check_in(wait,file->f_inode)) {
+				FD_SET(i,&res_in);
+				count++;
+			}
+			if (FD_ISSET(i,out) && check_out(wait,file->f_inode)) {
+				FD_SET(i,&res_out);
+				count++;
+			}
+		}
+		if (count || !select_wait(wait,timed))
+			break;
+		free_wait(wait);
+	}
+	current->state = TASK_RUNNING;
+	free_wait(wait);
+	free_page((long) wait);
+	*in = res_in;
+	*out = res_out;
+	return count;
+}
+
+//从用户空间取描述符集合，只取前n位
+static void get_fd_set(int n, fd_set * user, fd_set * set)
+{
+	int i;
+
+	FD_ZERO(set);
+	if (!user)
+		return;
+	for (i = 0 ; i < n ; i += NFDBITS)
+		set->fds_bits[i/NFDBITS] = get_fs_long(user->fds_bits + i/NFDBITS);
+	if (n % NFDBITS)
+		set->fds_bits[n/NFDBITS] &= (1UL << (n % NFDBITS)) - 1;
+}
+
+static void put_fd_set(int n, fd_set * user, fd_set * set)
+{
+	int i;
+
+	if (!user)
+		return;
+	verify_area(user,(n+NFDBITS-1)/NFDBITS*sizeof(unsigned long));
+	for (i = 0 ; i < n ; i += NFDBITS)
+		put_fs_long(set->fds_bits[i/NFDBITS],user->fds_bits + i/NFDBITS);
+}
+
+/*
+ * select(nfds, readfds, writefds, exceptfds, timeout). buffer points to
+ * the five arguments in user space. exceptfds is always returned empty.
+ */
+int sys_select(unsigned long * buffer)
+{
+	fd_set in, out, ex;
+	fd_set * inp, * outp, * exp;
+	struct timeval * tvp;
+	unsigned long timeout;
+	int n,i,count;
+
+	n = get_fs_long(buffer);
+	inp = (fd_set *) get_fs_long(buffer+1);
+	outp = (fd_set *) get_fs_long(buffer+2);
+	exp = (fd_set *) get_fs_long(buffer+3);
+	tvp = (struct timeval *) get_fs_long(buffer+4);
+	if (n < 0)
+		return -EINVAL;
+	if (n > NR_OPEN)
+		n = NR_OPEN;
+	get_fd_set(n,inp,&in);
+	get_fd_set(n,outp,&out);
+	for (i = 0 ; i < n ; i++)
+		if ((FD_ISSET(i,&in) || FD_ISSET(i,&out)) &&
+		    (i >= current->max_fds || !current->filp[i]))
+			return -EBADF;
+	//超时时间换算成滴答数，timeout为NULL表示一直等待
+	current->timeout = 0;
+	if (tvp) {
+		timeout = get_fs_long((unsigned long *) &tvp->tv_usec)/(1000000/HZ);
+		timeout += get_fs_long((unsigned long *) &tvp->tv_sec)*HZ;
+		if (timeout)
+			current->timeout = jiffies + timeout;
+	}
+	count = do_select(n,&in,&out,tvp != NULL);
+	current->timeout = 0;
+	if (count < 0)
+		return count;
+	if (!count && (current->signal & ~current->blocked))
+		return -EINTR;
+	FD_ZERO(&ex);
+	put_fd_set(n,inp,&in);
+	put_fd_set(n,outp,&out);
+	put_fd_set(n,exp,&ex);
+	return count;
+}
+
+/*
+ * poll(fds, nfds, timeout): timeout in milliseconds, negative means
+ * for ever. Returns the number of entries with a non-zero revents.
+ */
+int sys_poll(struct pollfd * fds, unsigned long nfds, int timeout)
+{
+	select_table * wait;
+	struct pollfd * pfd;
+	struct file * file;
+	int i,count;
+
+	if (nfds > MAX_POLL)
+		return -EINVAL;
+	if (!(wait = (select_table *) get_free_page()))
+		return -ENOMEM;
+	if (!(pfd = (struct pollfd *) get_free_page())) {
+		free_page((long) wait);
+		return -ENOMEM;
+	}
+	for (i = 0 ; i < nfds ; i++) {
+		pfd[i].fd = (int) get_fs_long((unsigned long *) &fds[i].fd);
+		pfd[i].events = (short) get_fs_word((unsigned short *) &fds[i].events);
+	}
+	current->timeout = 0;
+	if (timeout > 0)
+		current->timeout = jiffies + (timeout*HZ+999)/1000;
+	for (;;) {
+		current->state = TASK_INTERRUPTIBLE;
+		wait->nr = 0;
+		count = 0;
+		for (i = 0 ; i < nfds ; i++) {
+			pfd[i].revents = 0;
+			if (pfd[i].fd < 0)
+				continue;
+			if (pfd[i].fd >= current->max_fds ||
+			    !(file = current->filp[pfd[i].fd]))
+				pfd[i].revents = POLLNVAL;
+			else {
+				if ((pfd[i].events & POLLIN) &&
+				    check_in(wait,file->f_inode))
+					pfd[i].revents |= POLLIN;
+				if ((pfd[i].events & POLLOUT) &&
+				    check_out(wait,file->f_inode))
+					pfd[i].revents |= POLLOUT;
+				if (file->f_inode->i_pipe && file->f_inode->i_count != 2)
+					pfd[i].revents |= POLLHUP;
+			}
+			if (pfd[i].revents)
+				count++;
+		}
+		if (count || !select_wait(wait,timeout >= 0))
+			break;
+		free_wait(wait);
+	}
+	current->state = TASK_RUNNING;
+	free_wait(wait);
+	free_page((long) wait);
+	current->timeout = 0;
+	if (!count && (current->signal & ~current->blocked))
+		count = -EINTR;
+	else {
+		verify_area(fds,nfds*sizeof(struct pollfd));
+		for (i = 0 ; i < nfds ; i++)
+			put_fs_word(pfd[i].revents,&fds[i].revents);
+	}
+	free_page((long) pfd);
+	return count;
+}
@@ -5,17 +5,18 @@
  */
 
 #include <errno.h>
+#include <string.h>
 #include <sys/stat.h>
 
 #include <linux/fs.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
 #include <asm/segment.h>
 
 static void cp_stat(struct m_inode * inode, struct stat * statbuf)
 {
 	struct stat tmp;
-	int i;
 
 	verify_area(statbuf,sizeof (* statbuf));
 	tmp.st_dev = inode->i_dev;
@@ -29,8 +30,7 @@ static void cp_stat(struct m_inode * inode, struct stat * statbuf)
 	tmp.st_atime = inode->i_atime;
 	tmp.st_mtime = inode->i_mtime;
 	tmp.st_ctime = inode->i_ctime;
-	for (i=0 ; i<sizeof (tmp) ; i++)
-		put_fs_byte(((char *) &tmp)[i],&((char *) statbuf)[i]);
+	memcpy_tofs(statbuf,&tmp,sizeof (tmp));
 }
 
 int sys_stat(char * filename, struct stat * statbuf)
@@ -49,8 +49,86 @@ int sys_fstat(unsigned int fd, struct stat * statbuf)
 	struct file * f;
 	struct m_inode * inode;
 
-	if (fd >= NR_OPEN || !(f=current->filp[fd]) || !(inode=f->f_inode))
+	if (fd >= current->max_fds || !(f=current->filp[fd]) || !(inode=f->f_inode))
 		return -EBADF;
 	cp_stat(inode,statbuf);
 	return 0;
 }
+
+/*
+ * readdirplus() returns up to count entries of the directory fd from its
+ * current position on, each with the attributes ls -l wants, so that a
+ * listing needs no stat() - and no namei() - per name. The directory is
+ * read a batch of raw entries at a time, and the inodes of a batch are
+ * got in inode-number order: the inode-table blocks are then read in
+ * order, mostly by the read-ahead in read_inode(). Returns the number of
+ * records stored, 0 at the end of the directory.
+ */
+#define DIRPLUS_BATCH 64
+
+int sys_readdirplus(unsigned int fd, struct dirplus * buf, int count)
+{
+	struct file * f;
+	struct m_inode * dir, * inode;
+	struct dir_entry * de;
+	struct dirplus * dp;
+	unsigned char order[DIRPLUS_BATCH];
+	unsigned long old_fs;
+	int i,j,k,n,done = 0;
+
+	if (fd >= current->max_fds || !(f=current->filp[fd]) || !(dir=f->f_inode))
+		return -EBADF;
+	if (!S_ISDIR(dir->i_mode) || !dir->i_op || !dir->i_op->read)
+		return -ENOTDIR;
+	if (count <= 0)
+		return 0;
+	verify_area(buf,count * sizeof (struct dirplus));
+	//一页内存：前面放读入的目录项，后面放生成的记录
+	if (!(de = (struct dir_entry *) get_free_page()))
+		return -ENOMEM;
+	dp = (struct dirplus *) (de + DIRPLUS_BATCH);
+	while (done < count) {
+		n = (count-done < DIRPLUS_BATCH) ? count-done : DIRPLUS_BATCH;
+		n *= sizeof (struct dir_entry);
+		if (n > (int) (dir->i_size - f->f_pos))
+			n = dir->i_size - f->f_pos;
+		if (n <= 0)
+			break;
+		//read操作通过fs段访问缓冲区，让fs暂时指向内核数据段
+		old_fs = get_fs();
+		set_fs(get_ds());
+		n = dir->i_op->read(dir,f,(char *) de,n);
+		set_fs(old_fs);
+		if ((n /= sizeof (struct dir_entry)) <= 0)
+			break;
+		//把在用的目录项按i节点号排序(插入排序)
+		for (i=k=0 ; i<n ; i++) {
+			if (!de[i].inode)
+				continue;
+			for (j=k++ ; j>0 && de[order[j-1]].inode > de[i].inode ; j--)
+				order[j] = order[j-1];
+			order[j] = i;
+		}
+		//按i节点号顺序取i节点，填写记录
+		for (i=0 ; i<k ; i++) {
+			j = order[i];
+			memset(dp+j,0,sizeof (struct dirplus));
+			dp[j].d_ino = de[j].inode;
+			memcpy(dp[j].d_name,de[j].name,NAME_LEN);
+			if (!(inode = iget(dir->i_dev,de[j].inode)))
+				continue;
+			dp[j].d_mode = inode->i_mode;
+			dp[j].d_uid = inode->i_uid;
+			dp[j].d_gid = inode->i_gid;
+			dp[j].d_size = inode->i_size;
+			dp[j].d_mtime = inode->i_mtime;
+			iput(inode);
+		}
+		//记录按目录中的顺序交给用户
+		for (i=0 ; i<n ; i++)
+			if (de[i].inode)
+				memcpy_tofs(buf + done++,dp+i,sizeof (struct dirplus));
+	}
+	free_page((unsigned long) de);
+	return done;
+}
@@ -11,12 +11,15 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <asm/system.h>
+#include <asm/segment.h>
 
 #include <errno.h>
 #include <sys/stat.h>
 
 int sync_dev(int dev);
 void wait_for_keypress(void);
+extern void minix_read_inode(struct m_inode * inode);
+extern void minix_write_inode(struct m_inode * inode);
 
 /* set_bit uses setb, as gas doesn't recognize setc */
 #define set_bit(bitnr,addr) ({ \
@@ -24,10 +27,97 @@ register int __res __asm__("ax"); \
 __asm__("bt %2,%3;setb %%al":"=a" (__res):"a" (0),"r" (bitnr),"m" (*(addr))); \
 __res; })
 
+//统计位图中第1位到第bits位中0值位的个数(第0位保留不用)，位图共有blocks块
+static int count_free(struct buffer_head ** map, int blocks, unsigned long bits)
+{
+	unsigned long i,free=0;
+
+	for (i=1 ; i<=bits ; i++) {
+		if ((i>>13) >= blocks || !map[i>>13])
+			break;
+		if (!set_bit(i&8191,map[i>>13]->b_data))
+			free++;
+	}
+	return free;
+}
+
+/*
+ * The bitmap buffer pointers of a mounted device live in one page: the
+ * inode-map pointers first, the zone-map pointers right after them.
+ */
+#define MAX_MAP_BLOCKS (PAGE_SIZE/sizeof (struct buffer_head *))
+
+//释放超级块的位图缓冲块和存放其指针的页面
+static void free_maps(struct super_block * sb)
+{
+	int i;
+
+	if (!sb->s_imap)
+		return;
+	for (i=0 ; i<sb->s_imap_blocks ; i++)
+		brelse(sb->s_imap[i]);
+	for (i=0 ; i<sb->s_zmap_blocks ; i++)
+		brelse(sb->s_zmap[i]);
+	free_page((unsigned long) sb->s_imap);
+	sb->s_imap = sb->s_zmap = NULL;
+}
+
 struct super_block super_block[NR_SUPER];
 /* this is initialized in init/main.c */
 int ROOT_DEV = 0;
 
+struct super_operations minix_super_operations = {
+	minix_read_inode,
+	minix_write_inode,
+	free_inode,
+	free_maps
+};
+
+/*
+ * The known file system types. A block device is mounted as the first
+ * type with requires_dev whose read_super() accepts it; the others are
+ * mounted by giving their name instead of a device.
+ */
+static struct file_system_type file_systems[] = {
+	{minix_read_super, "minix", 1},
+	{tmpfs_read_super, "tmpfs", 0},
+	{NULL, NULL, 0}
+};
+
+//按用户空间中的名字查找不需要设备的文件系统类型，没有则返回NULL
+static struct file_system_type * get_nodev_type(const char * name)
+{
+	struct file_system_type * type;
+	int i;
+
+	for (type = file_systems ; type->read_super ; type++) {
+		if (type->requires_dev)
+			continue;
+		for (i=0 ; type->name[i] ; i++)
+			if (get_fs_byte(name+i) != type->name[i])
+				break;
+		if (!type->name[i] && !get_fs_byte(name+i))
+			return type;
+	}
+	return NULL;
+}
+
+//为不使用块设备的文件系统取一个空闲的设备号(主设备号UNNAMED_MAJOR)
+static int get_unnamed_dev(void)
+{
+	struct super_block * s;
+	int dev;
+
+	for (dev = (UNNAMED_MAJOR<<8)+1 ; dev < (UNNAMED_MAJOR<<8)+256 ; dev++) {
+		for (s = 0+super_block ; s < NR_SUPER+super_block ; s++)
+			if (s->s_dev == dev)
+				break;
+		if (s >= NR_SUPER+super_block)
+			return dev;
+	}
+	return 0;
+}
+
 static void lock_super(struct super_block * sb)
 {
 	cli();
@@ -74,11 +164,23 @@ struct super_block * get_super(int dev)
 	return NULL;
 }
 
+//设备dev上安装的文件系统是否只读，没有安装文件系统时返回0
+int fs_rdonly(int dev)
+{
+	struct super_block * s;
+
+	if (!dev)
+		return 0;
+	for (s = 0+super_block ; s < NR_SUPER+super_block ; s++)
+		if (s->s_dev == dev)
+			return s->s_rd_only;
+	return 0;
+}
+
 void put_super(int dev)
 {
 	struct super_block * sb;
 	struct m_inode * inode;
-	int i;
 
 	if (dev == ROOT_DEV) {
 		printk("root diskette changed: prepare for armageddon\n\r");
@@ -90,24 +192,24 @@ void put_super(int dev)
 		printk("Mounted disk changed - tssk, tssk\n\r");
 		return;
 	}
+	//日志要在超级块上锁之前写完并放掉，其间还要用get_super()
+	if (sb->s_journal)
+		journal_release(sb);
+	invalidate_pages(dev,0);
 	lock_super(sb);
+	if (sb->s_op && sb->s_op->put_super)
+		sb->s_op->put_super(sb);
 	sb->s_dev = 0;
-	for(i=0;i<I_MAP_SLOTS;i++)
-		brelse(sb->s_imap[i]);
-	for(i=0;i<Z_MAP_SLOTS;i++)
-		brelse(sb->s_zmap[i]);
 	free_super(sb);
 	return;
 }
 
 //读取指定设备的超级块
 //如果指定设备dev上的文件系统超级块已经在超级块表中，则直接返回该超级块项的指针
-//否则就从设备dev上读取超级块到缓冲块中，并复制到超级块中，并返回超级块指针
-static struct super_block * read_super(int dev)
+//否则在超级块表中取一个空项，由文件系统类型type(为NULL时逐个试需要设备的类型)的read_super()填写
+static struct super_block * read_super(int dev, struct file_system_type * type)
 {
 	struct super_block * s;
-	struct buffer_head * bh;
-	int i,block;
 
 	//判断参数的有效性，如果没有指明设备，则返回空指针
 	if (!dev)
@@ -131,34 +233,70 @@ static struct super_block * read_super(int dev)
 	s->s_isup = NULL;
 	s->s_imount = NULL;
 	s->s_time = 0;
-	s->s_rd_only = 0;
+	s->s_rd_only = is_read_only(dev);	//只读设备上的文件系统只能只读安装
 	s->s_dirt = 0;
+	s->s_imap = s->s_zmap = NULL;
+	s->s_itable = NULL;
+	s->s_zdelay = 0;
+	s->s_op = NULL;
+	s->s_journal = NULL;
 	//锁定该超级块
 	lock_super(s);
-	//从设备上读取超级块信息到bh指向的缓冲块中
-	//超级块位于块设备的第2个逻辑块(1号块)中，第1个引导盘块
-	if (!(bh = bread(dev,1))) {
-		s->s_dev=0;
+	if (type)
+		type = type->read_super(s) ? type : NULL;
+	else
+		for (type = file_systems ; type->read_super ; type++)
+			if (type->requires_dev && type->read_super(s))
+				break;
+	if (!type || !type->read_super) {
+		s->s_dev = 0;
 		free_super(s);
 		return NULL;
 	}
+	//解锁该超级块
+	free_super(s);
+	//可写的minix文件系统上有日志就先重放，位图可能变了，空闲数要重新统计
+	if (s->s_op == &minix_super_operations && !s->s_rd_only &&
+	    journal_load(s)) {
+		s->s_zfree = count_free(s->s_zmap,s->s_zmap_blocks,
+			s->s_zones-s->s_firstdatazone);
+		s->s_ifree = count_free(s->s_imap,s->s_imap_blocks,s->s_ninodes);
+	}
+	return s;
+}
+
+//minix文件系统的read_super：从设备上读入超级块和位图，不是minix文件系统则返回NULL
+struct super_block * minix_read_super(struct super_block * s)
+{
+	struct buffer_head * bh;
+	int i,block,dev = s->s_dev;
+
+	//从设备上读取超级块信息到bh指向的缓冲块中
+	//超级块位于块设备的第2个逻辑块(1号块)中，第1个引导盘块
+	if (!(bh = bread(dev,1)))
+		return NULL;
 	//将设备上读到的超级块信息从缓冲块数据区复制到数据块数组相应结构中
 	*((struct d_super_block *) s) =
 		*((struct d_super_block *) bh->b_data);
 	//释放存放读取信息的高速缓冲块
 	brelse(bh);
-	//朝看超级块的文件系统魔数字段是否正确
-	if (s->s_magic != SUPER_MAGIC) {
-		s->s_dev = 0;
-		free_super(s);
+	//查看超级块的文件系统魔数字段是否正确，并确定文件系统格式
+	//v1超级块中没有s_zones字段，逻辑块数取自16位的s_nzones
+	if (s->s_magic == SUPER_MAGIC) {
+		s->s_version = 1;
+		s->s_zones = s->s_nzones;
+	} else if (s->s_magic == SUPER_MAGIC_V2)
+		s->s_version = 2;
+	else
 		return NULL;
-	}
 	//下面开始读取设备上i节点位图和逻辑块位图数据
-	//初始化内存超级块结构中位图空间
-	for (i=0;i<I_MAP_SLOTS;i++)
-		s->s_imap[i] = NULL;
-	for (i=0;i<Z_MAP_SLOTS;i++)
-		s->s_zmap[i] = NULL;
+	//位图缓冲块指针数组放在一页内存中，其大小随位图块数而定
+	if (s->s_imap_blocks + s->s_zmap_blocks > MAX_MAP_BLOCKS ||
+	    !(s->s_imap = (struct buffer_head **) get_free_page())) {
+		printk("read_super: bitmaps of dev %04x too big\n",dev);
+		return NULL;
+	}
+	s->s_zmap = s->s_imap + s->s_imap_blocks;
 	block=2;
 	//从设备上读取i节点位图和逻辑块位图信息，并存放在超级块对应字段中
 	//i节点位图保存在设备上2号块开始的逻辑块中，共占用s_imap_blocks个块
@@ -176,12 +314,7 @@ static struct super_block * read_super(int dev)
 	//如果读出的位图块数不等于位图应该占用的逻辑块数，说明超级块初始化失败
 	//释放前面申请并占用的资源
 	if (block != 2+s->s_imap_blocks+s->s_zmap_blocks) {
-		for(i=0;i<I_MAP_SLOTS;i++)
-			brelse(s->s_imap[i]);
-		for(i=0;i<Z_MAP_SLOTS;i++)
-			brelse(s->s_zmap[i]);
-		s->s_dev=0;
-		free_super(s);
+		free_maps(s);
 		return NULL;
 	}
 	//由于对于申请空闲i节点的函数来讲，如果设备上所有的i节点已经全被使用，则查找函数会返回0值
@@ -189,8 +322,11 @@ static struct super_block * read_super(int dev)
 	//同样道理，也将逻辑块位图的最低位设置为1
 	s->s_imap[0]->b_data[0] |= 1;
 	s->s_zmap[0]->b_data[0] |= 1;
-	//解锁该超级块
-	free_super(s);
+	//统计一次空闲逻辑块数和空闲i节点数，以后由分配和释放函数维护
+	s->s_zfree = count_free(s->s_zmap,s->s_zmap_blocks,
+		s->s_zones-s->s_firstdatazone);
+	s->s_ifree = count_free(s->s_imap,s->s_imap_blocks,s->s_ninodes);
+	s->s_op = &minix_super_operations;
 	return s;
 }
 
@@ -202,8 +338,12 @@ int sys_umount(char * dev_name)
 
 	if (!(inode=namei(dev_name)))
 		return -ENOENT;
-	dev = inode->i_zone[0];
-	if (!S_ISBLK(inode->i_mode)) {
+	//没有设备的文件系统按安装点卸载：namei()取到的是安装上去的根i节点
+	if (S_ISBLK(inode->i_mode))
+		dev = inode->i_zone[0];
+	else if (S_ISDIR(inode->i_mode) && inode->i_num == ROOT_INO)
+		dev = inode->i_dev;
+	else {
 		iput(inode);
 		return -ENOTBLK;
 	}
@@ -214,8 +354,10 @@ int sys_umount(char * dev_name)
 		return -ENOENT;
 	if (!sb->s_imount->i_mount)
 		printk("Mounted inode has i_mount=0\n");
+	reclaim_inodes(dev);
 	for (inode=inode_table+0 ; inode<inode_table+NR_INODE ; inode++)
-		if (inode->i_dev==dev && inode->i_count)
+		if (inode->i_dev==dev && inode->i_count &&
+		    !(sb->s_journal && inode == sb->s_journal->j_inode))
 				return -EBUSY;
 	sb->s_imount->i_mount=0;
 	iput(sb->s_imount);
@@ -227,42 +369,45 @@ int sys_umount(char * dev_name)
 	return 0;
 }
 
+//安装文件系统。dev_name是块设备文件名，或者是不需要设备的文件系统类型名(如"tmpfs")
 int sys_mount(char * dev_name, char * dir_name, int rw_flag)
 {
 	struct m_inode * dev_i, * dir_i;
 	struct super_block * sb;
+	struct file_system_type * type;
 	int dev;
 
-	if (!(dev_i=namei(dev_name)))
-		return -ENOENT;
-	dev = dev_i->i_zone[0];
-	if (!S_ISBLK(dev_i->i_mode)) {
+	if (type = get_nodev_type(dev_name)) {
+		if (!(dev = get_unnamed_dev()))
+			return -EBUSY;
+	} else {
+		if (!(dev_i=namei(dev_name)))
+			return -ENOENT;
+		dev = dev_i->i_zone[0];
+		if (!S_ISBLK(dev_i->i_mode)) {
+			iput(dev_i);
+			return -EPERM;
+		}
 		iput(dev_i);
-		return -EPERM;
 	}
-	iput(dev_i);
 	if (!(dir_i=namei(dir_name)))
 		return -ENOENT;
 	if (dir_i->i_count != 1 || dir_i->i_num == ROOT_INO) {
 		iput(dir_i);
 		return -EBUSY;
 	}
-	if (!S_ISDIR(dir_i->i_mode)) {
+	if (!S_ISDIR(dir_i->i_mode) || dir_i->i_mount) {
 		iput(dir_i);
 		return -EPERM;
 	}
-	if (!(sb=read_super(dev))) {
+	if (!(sb=read_super(dev,type))) {
 		iput(dir_i);
-		return -EBUSY;
+		return type ? -ENOMEM : -EBUSY;
 	}
 	if (sb->s_imount) {
 		iput(dir_i);
 		return -EBUSY;
 	}
-	if (dir_i->i_mount) {
-		iput(dir_i);
-		return -EPERM;
-	}
 	sb->s_imount=dir_i;
 	dir_i->i_mount=1;
 	dir_i->i_dirt=1;		/* NOTE! we don't iput(dir_i) */
@@ -270,21 +415,17 @@ int sys_mount(char * dev_name, char * dir_name, int rw_flag)
 }
 
 //安装根文件系统
-//函数首先初始化文件表数组file_table[]和超级块表(数组)
+//函数首先初始化超级块表(数组)，文件结构在用到时才分配，不需要初始化
 //然后读取根文件系统超级块，并取得文件系统根i节点
 //最后统计并显示出根文件系统上的可用资源(空闲块数和空闲i节点数)
 void mount_root(void)
 {
-	int i,free;
 	struct super_block * p;
 	struct m_inode * mi;
 
 	//若磁盘i节点不是32字节，则出错停机
-	if (32 != sizeof (struct d_inode))
+	if (32 != sizeof (struct d_inode) || 64 != sizeof (struct d2_inode))
 		panic("bad i-node size");
-	//初始化文件表数组(共64x项，即系统同时只能打开64个文件)
-	for(i=0;i<NR_FILE;i++)
-		file_table[i].f_count=0;		//将所有文件结构中的引用计数设置为0(表示空闲)
 	//如果根文件系统所在设备是软盘的话，就提示"插入根文件系统盘"
 	//2代表软盘，此时根设备是虚拟盘，是1
 	if (MAJOR(ROOT_DEV) == 2) {
@@ -299,7 +440,7 @@ void mount_root(void)
 	}
 	//开始安装根文件系统
 	//从根设备上读取文件系统超级块，并取得文件系统的根i节点(1号节点)在内存i节点表中的指针
-	if (!(p=read_super(ROOT_DEV)))
+	if (!(p=read_super(ROOT_DEV,NULL)))
 		panic("Unable to mount root");
 	if (!(mi=iget(ROOT_DEV,ROOT_INO)))	//ROOT_INO=1
 		panic("Unable to read root i-node");
@@ -311,19 +452,7 @@ void mount_root(void)
 	//设置当前进程的当前工作目录和根目录i节点，此时当前进程是1号进程(init进程)
 	current->pwd = mi;			//当前进程掌控根文件系统的根i节点
 	current->root = mi;			//父子进程创建机制将这个特性遗传给子进程
-	//然后对根文件系统上的资源作统计工作，统计该设备上空闲块数和空闲i节点数
-	//空闲块数
-	free=0;
-	i=p->s_nzones;
-	while (-- i >= 0)
-		if (!set_bit(i&8191,p->s_zmap[i>>13]->b_data))
-			free++;
-	printk("%d/%d free blocks\n\r",free,p->s_nzones);
-	//空闲i节点数
-	free=0;
-	i=p->s_ninodes+1;
-	while (-- i >= 0)
-		if (!set_bit(i&8191,p->s_imap[i>>13]->b_data))
-			free++;
-	printk("%d/%d free inodes\n\r",free,p->s_ninodes);
+	//然后显示根文件系统上的空闲块数和空闲i节点数(在read_super()中已统计好)
+	printk("%d/%d free blocks\n\r",p->s_zfree,p->s_zones);
+	printk("%d/%d free inodes\n\r",p->s_ifree,p->s_ninodes);
 }
@@ -0,0 +1,648 @@
+/*
+ *  linux/fs/tmpfs.c
+ */
+
+/*
+ * tmpfs keeps everything in memory pages from get_free_page(), and never
+ * goes through the buffer cache or a block device. It is mounted by
+ * giving "tmpfs" instead of a device name.
+ *
+ * The inodes are d2_inodes in pages listed in s_itable; an inode is free
+ * when both its mode and its link count are 0. i_zone[] holds page
+ * addresses instead of zone numbers: 0-8 are the first pages of the
+ * file, 9 is a page of addresses of the following ones. Directories
+ * are files of dir_entry, exactly as on a minix file system.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <const.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+#define TMPFS_IPP (PAGE_SIZE/(sizeof (struct d2_inode)))	//每页i节点数
+#define TMPFS_INODES (64*TMPFS_IPP-1)						//i节点数(0号不用)
+#define TMPFS_PAGES 1024									//最多使用的数据页面数
+#define TMPFS_DIRECT 9										//直接页面数
+#define ADDR_PER_PAGE (PAGE_SIZE/sizeof (unsigned long))
+#define DIR_ENTRIES_PER_PAGE (PAGE_SIZE/(sizeof (struct dir_entry)))
+
+static struct inode_operations tmpfs_inode_operations;
+
+//取i节点表中nr号i节点，所在页面还没有分配则返回NULL
+static struct d2_inode * tmpfs_slot(struct super_block * sb, int nr)
+{
+	unsigned long page;
+
+	if (nr < 1 || nr > sb->s_ninodes || !(page = sb->s_itable[nr/TMPFS_IPP]))
+		return NULL;
+	return (struct d2_inode *) page + nr%TMPFS_IPP;
+}
+
+static void slot_to_inode(struct d2_inode * d, struct m_inode * inode)
+{
+	int i;
+
+	inode->i_mode = d->i_mode;
+	inode->i_uid = d->i_uid;
+	inode->i_gid = d->i_gid;
+	inode->i_nlinks = d->i_nlinks;
+	inode->i_size = d->i_size;
+	inode->i_atime = d->i_atime;
+	inode->i_mtime = d->i_mtime;
+	inode->i_ctime = d->i_ctime;
+	for (i=0 ; i<10 ; i++)
+		inode->i_zone[i] = d->i_zone[i];
+}
+
+static void inode_to_slot(struct m_inode * inode, struct d2_inode * d)
+{
+	int i;
+
+	d->i_mode = inode->i_mode;
+	d->i_uid = inode->i_uid;
+	d->i_gid = inode->i_gid;
+	d->i_nlinks = inode->i_nlinks;
+	d->i_size = inode->i_size;
+	d->i_atime = inode->i_atime;
+	d->i_mtime = inode->i_mtime;
+	d->i_ctime = inode->i_ctime;
+	for (i=0 ; i<10 ; i++)
+		d->i_zone[i] = inode->i_zone[i];
+	inode->i_dirt = 0;
+	inode->i_dsync = 0;
+}
+
+//释放页面地址数组zone(i_zone[])指向的全部数据页面，返回释放的页面数
+static int free_data(unsigned long * zone)
+{
+	unsigned long * ind;
+	int i,n = 0;
+
+	for (i=0 ; i<TMPFS_DIRECT ; i++)
+		if (zone[i]) {
+			free_page(zone[i]);
+			zone[i] = 0;
+			n++;
+		}
+	if (ind = (unsigned long *) zone[TMPFS_DIRECT]) {
+		for (i=0 ; i<ADDR_PER_PAGE ; i++)
+			if (ind[i]) {
+				free_page(ind[i]);
+				n++;
+			}
+		free_page((unsigned long) ind);
+		zone[TMPFS_DIRECT] = 0;
+		n++;
+	}
+	return n;
+}
+
+//为i节点取一个数据页面(已清零)，超过文件系统的页面数限制时返回0
+static unsigned long get_data_page(struct m_inode * inode)
+{
+	struct super_block * sb = get_super(inode->i_dev);
+	unsigned long page;
+
+	if (!sb->s_zfree || !(page = get_free_page()))
+		return 0;
+	sb->s_zfree--;
+	inode->i_dirt = 1;
+	return page;
+}
+
+//返回文件第n页的页面地址，create为1时没有就分配一页
+static unsigned long tmpfs_page(struct m_inode * inode, int n, int create)
+{
+	unsigned long * p;
+
+	if (n < 0 || n >= TMPFS_DIRECT+ADDR_PER_PAGE)
+		return 0;
+	if (n < TMPFS_DIRECT)
+		p = inode->i_zone + n;
+	else {
+		if (!inode->i_zone[TMPFS_DIRECT] && (!create ||
+		    !(inode->i_zone[TMPFS_DIRECT] = get_data_page(inode))))
+			return 0;
+		p = (unsigned long *) inode->i_zone[TMPFS_DIRECT] + n-TMPFS_DIRECT;
+	}
+	if (!*p && create)
+		*p = get_data_page(inode);
+	return *p;
+}
+
+static void tmpfs_read_inode(struct m_inode * inode)
+{
+	struct d2_inode * d;
+
+	if (!(d = tmpfs_slot(get_super(inode->i_dev),inode->i_num)))
+		panic("tmpfs: trying to read nonexistent inode");
+	slot_to_inode(d,inode);
+	inode->i_op = &tmpfs_inode_operations;
+}
+
+static void tmpfs_write_inode(struct m_inode * inode)
+{
+	struct d2_inode * d;
+
+	if (!(d = tmpfs_slot(get_super(inode->i_dev),inode->i_num)))
+		panic("tmpfs: trying to write nonexistent inode");
+	inode_to_slot(inode,d);
+}
+
+static void tmpfs_free_inode(struct m_inode * inode)
+{
+	struct super_block * sb = get_super(inode->i_dev);
+	struct d2_inode * d;
+
+	if (d = tmpfs_slot(sb,inode->i_num)) {
+		memset(d,0,sizeof(*d));
+		sb->s_ifree++;
+	}
+	memset(inode,0,sizeof(*inode));
+}
+
+//取一个空闲i节点，i节点表页面在用到时才分配
+static struct m_inode * tmpfs_new_inode(struct m_inode * dir, int mode)
+{
+	struct super_block * sb;
+	struct m_inode * inode;
+	struct d2_inode * d;
+	int nr;
+
+	if (!(inode = get_empty_inode()))
+		return NULL;
+	sb = get_super(dir->i_dev);
+	//找到空闲表项时d指向它，否则为NULL
+	for (nr = 1, d = NULL ; sb->s_ifree && nr <= sb->s_ninodes ; nr++) {
+		if (!sb->s_itable[nr/TMPFS_IPP] &&
+		    !(sb->s_itable[nr/TMPFS_IPP] = get_free_page()))
+			break;
+		d = tmpfs_slot(sb,nr);
+		if (!d->i_mode && !d->i_nlinks)
+			break;
+		d = NULL;
+	}
+	if (!d) {
+		iput(inode);
+		return NULL;
+	}
+	//马上占用表项，i节点写回之前它不会再被分配出去
+	d->i_mode = mode;
+	d->i_nlinks = 1;
+	sb->s_ifree--;
+	inode->i_mode = mode;
+	inode->i_nlinks = 1;
+	inode->i_dev = dir->i_dev;
+	inode->i_num = nr;
+	inode->i_uid = current->euid;
+	inode->i_gid = current->egid;
+	inode->i_mtime = inode->i_atime = inode->i_ctime = CURRENT_TIME;
+	inode->i_dirt = 1;
+	inode->i_op = &tmpfs_inode_operations;
+	return inode;
+}
+
+static int tmpfs_match(int len, const char * name, struct dir_entry * de)
+{
+	int i;
+
+	if (!de || !de->inode || len > NAME_LEN)
+		return 0;
+	if (len < NAME_LEN && de->name[len])
+		return 0;
+	for (i=0 ; i<len ; i++)
+		if (de->name[i] != get_fs_byte(name+i))
+			return 0;
+	return 1;
+}
+
+//目录中第i个目录项
+static struct dir_entry * tmpfs_entry(struct m_inode * dir, int i, int create)
+{
+	unsigned long page;
+
+	if (!(page = tmpfs_page(dir,i/DIR_ENTRIES_PER_PAGE,create)))
+		return NULL;
+	return (struct dir_entry *) page + i%DIR_ENTRIES_PER_PAGE;
+}
+
+static struct dir_entry * tmpfs_find(struct m_inode * dir,
+	const char * name, int len)
+{
+	struct dir_entry * de;
+	int i,entries;
+
+	if (len > NAME_LEN)
+		len = NAME_LEN;
+	entries = dir->i_size / (sizeof (struct dir_entry));
+	for (i=0 ; len && i<entries ; i++)
+		if (tmpfs_match(len,name,de = tmpfs_entry(dir,i,0)))
+			return de;
+	return NULL;
+}
+
+//在目录中添加名字name，i节点号为ino。先用空闲的目录项，没有才加在目录末尾
+static int tmpfs_add(struct m_inode * dir, const char * name, int len, int ino)
+{
+	struct dir_entry * de;
+	int i,entries;
+
+	if (len > NAME_LEN)
+		len = NAME_LEN;
+	if (!len)
+		return -ENOENT;
+	entries = dir->i_size / (sizeof (struct dir_entry));
+	for (i=0 ; i<entries ; i++)
+		if ((de = tmpfs_entry(dir,i,0)) && !de->inode)
+			break;
+	if (i >= entries) {
+		if (!(de = tmpfs_entry(dir,i,1)))
+			return -ENOSPC;
+		dir->i_size = (i+1)*sizeof (struct dir_entry);
+	}
+	de->inode = ino;
+	for (i=0 ; i<NAME_LEN ; i++)
+		de->name[i] = (i<len) ? get_fs_byte(name+i) : 0;
+	dir->i_mtime = dir->i_ctime = CURRENT_TIME;
+	dir->i_dirt = 1;
+	return 0;
+}
+
+static int tmpfs_lookup(struct m_inode * dir, const char * name, int len,
+	struct m_inode ** res_inode)
+{
+	struct dir_entry * de;
+
+	*res_inode = NULL;
+	if (!(de = tmpfs_find(dir,name,len)))
+		return -ENOENT;
+	if (!(*res_inode = iget(dir->i_dev,de->inode)))
+		return -EACCES;
+	return 0;
+}
+
+static int tmpfs_create(struct m_inode * dir, const char * name, int len,
+	int mode, struct m_inode ** res_inode)
+{
+	struct m_inode * inode;
+	int error;
+
+	*res_inode = NULL;
+	if (!(inode = tmpfs_new_inode(dir,mode)))
+		return -ENOSPC;
+	if (error = tmpfs_add(dir,name,len,inode->i_num)) {
+		inode->i_nlinks = 0;
+		iput(inode);
+		return error;
+	}
+	*res_inode = inode;
+	return 0;
+}
+
+static int tmpfs_mknod(struct m_inode * dir, const char * name, int len,
+	int mode, int rdev)
+{
+	struct m_inode * inode;
+	int error;
+
+	if (tmpfs_find(dir,name,len))
+		return -EEXIST;
+	if (!(inode = tmpfs_new_inode(dir,mode)))
+		return -ENOSPC;
+	if (S_ISBLK(mode) || S_ISCHR(mode))
+		inode->i_zone[0] = rdev;
+	if (error = tmpfs_add(dir,name,len,inode->i_num))
+		inode->i_nlinks = 0;
+	iput(inode);
+	return error;
+}
+
+static int tmpfs_mkdir(struct m_inode * dir, const char * name, int len,
+	int mode)
+{
+	struct m_inode * inode;
+	struct dir_entry * de;
+	int error;
+
+	if (tmpfs_find(dir,name,len))
+		return -EEXIST;
+	if (!(inode = tmpfs_new_inode(dir,
+	    I_DIRECTORY | (mode & 0777 & ~current->umask))))
+		return -ENOSPC;
+	if (!(de = tmpfs_entry(inode,0,1))) {
+		inode->i_nlinks = 0;
+		iput(inode);
+		return -ENOSPC;
+	}
+	de->inode = inode->i_num;
+	strcpy(de->name,".");
+	de++;
+	de->inode = dir->i_num;
+	strcpy(de->name,"..");
+	inode->i_size = 2*sizeof (struct dir_entry);
+	inode->i_nlinks = 2;
+	if (error = tmpfs_add(dir,name,len,inode->i_num)) {
+		inode->i_nlinks = 0;
+		iput(inode);
+		return error;
+	}
+	dir->i_nlinks++;
+	dir->i_dirt = 1;
+	iput(inode);
+	return 0;
+}
+
+static int tmpfs_empty_dir(struct m_inode * inode)
+{
+	struct dir_entry * de;
+	int i,entries;
+
+	entries = inode->i_size / (sizeof (struct dir_entry));
+	for (i=2 ; i<entries ; i++)
+		if ((de = tmpfs_entry(inode,i,0)) && de->inode)
+			return 0;
+	return 1;
+}
+
+static int tmpfs_rmdir(struct m_inode * dir, const char * name, int len)
+{
+	struct m_inode * inode;
+	struct dir_entry * de;
+	int error = 0;
+
+	if (!(de = tmpfs_find(dir,name,len)))
+		return -ENOENT;
+	if (!(inode = iget(dir->i_dev,de->inode)))
+		return -EPERM;
+	if ((dir->i_mode & S_ISVTX) && current->euid &&
+	    inode->i_uid != current->euid)
+		error = -EPERM;
+	else if (inode->i_dev != dir->i_dev || inode->i_count>1 || inode == dir)
+		error = -EPERM;
+	else if (!S_ISDIR(inode->i_mode))
+		error = -ENOTDIR;
+	else if (!tmpfs_empty_dir(inode))
+		error = -ENOTEMPTY;
+	if (error) {
+		iput(inode);
+		return error;
+	}
+	de->inode = 0;
+	inode->i_nlinks = 0;
+	inode->i_dirt = 1;
+	dir->i_nlinks--;
+	dir->i_ctime = dir->i_mtime = CURRENT_TIME;
+	dir->i_dirt = 1;
+	iput(inode);
+	return 0;
+}
+
+static int tmpfs_unlink(struct m_inode * dir, const char * name, int len)
+{
+	struct m_inode * inode;
+	struct dir_entry * de;
+
+	if (!(de = tmpfs_find(dir,name,len)))
+		return -ENOENT;
+	if (!(inode = iget(dir->i_dev,de->inode)))
+		return -ENOENT;
+	if (((dir->i_mode & S_ISVTX) && !suser() &&
+	    current->euid != inode->i_uid &&
+	    current->euid != dir->i_uid) || S_ISDIR(inode->i_mode)) {
+		iput(inode);
+		return -EPERM;
+	}
+	de->inode = 0;
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_dirt = 1;
+	if (inode->i_nlinks)
+		inode->i_nlinks--;
+	inode->i_dirt = 1;
+	inode->i_ctime = CURRENT_TIME;
+	iput(inode);
+	return 0;
+}
+
+static int tmpfs_link(struct m_inode * oldinode, struct m_inode * dir,
+	const char * name, int len)
+{
+	int error;
+
+	if (tmpfs_find(dir,name,len))
+		return -EEXIST;
+	if (error = tmpfs_add(dir,name,len,oldinode->i_num))
+		return error;
+	oldinode->i_nlinks++;
+	oldinode->i_ctime = CURRENT_TIME;
+	oldinode->i_dirt = 1;
+	return 0;
+}
+
+//读文件。count已由sys_read()限制在文件长度之内，没有页面的地方读出0
+static int tmpfs_read(struct m_inode * inode, struct file * filp,
+	char * buf, int count)
+{
+	unsigned long page;
+	int left,chars,nr;
+
+	if ((left=count)<=0)
+		return 0;
+	while (left) {
+		page = tmpfs_page(inode,filp->f_pos/PAGE_SIZE,0);
+		nr = filp->f_pos % PAGE_SIZE;
+		chars = MIN(PAGE_SIZE-nr,left);
+		filp->f_pos += chars;
+		left -= chars;
+		if (page) {
+			memcpy_tofs(buf,(char *) page+nr,chars);
+			buf += chars;
+		} else {
+			clear_fs(buf,chars);
+			buf += chars;
+		}
+	}
+	inode->i_atime = CURRENT_TIME;
+	return count;
+}
+
+static int tmpfs_write(struct m_inode * inode, struct file * filp,
+	char * buf, int count)
+{
+	unsigned long page;
+	off_t pos;
+	int c,i=0;
+
+	if (filp->f_flags & O_APPEND)
+		pos = inode->i_size;
+	else
+		pos = filp->f_pos;
+	while (i<count) {
+		if (!(page = tmpfs_page(inode,pos/PAGE_SIZE,1)))
+			break;
+		c = pos % PAGE_SIZE;
+		page += c;
+		c = PAGE_SIZE-c;
+		if (c > count-i) c = count-i;
+		memcpy_fromfs((char *) page,buf,c);
+		pos += c;
+		if (pos > inode->i_size) {
+			inode->i_size = pos;
+			inode->i_dirt = 1;
+		}
+		i += c;
+		buf += c;
+	}
+	inode->i_mtime = CURRENT_TIME;
+	if (!(filp->f_flags & O_APPEND)) {
+		filp->f_pos = pos;
+		inode->i_ctime = CURRENT_TIME;
+	}
+	return (i?i:-ENOSPC);
+}
+
+static void tmpfs_truncate(struct m_inode * inode)
+{
+	if (!(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode)))
+		return;
+	get_super(inode->i_dev)->s_zfree += free_data(inode->i_zone);
+	inode->i_size = 0;
+	inode->i_dirt = 1;
+	inode->i_mtime = inode->i_ctime = CURRENT_TIME;
+}
+
+//按块复制，off可以不在页边界上(执行文件的数据从第2块开始)
+static int tmpfs_readpage(struct m_inode * inode, unsigned long off,
+	unsigned long page)
+{
+	unsigned long from;
+	int i;
+
+	for (i=0 ; i<4 ; i++,off += BLOCK_SIZE,page += BLOCK_SIZE)
+		if (off < inode->i_size &&
+		    (from = tmpfs_page(inode,off/PAGE_SIZE,0)))
+			memcpy((char *) page,(char *) from+off%PAGE_SIZE,BLOCK_SIZE);
+		else
+			memset((char *) page,0,BLOCK_SIZE);
+	return 0;
+}
+
+static void tmpfs_writepage(struct m_inode * inode, unsigned long off,
+	unsigned long page)
+{
+	unsigned long to;
+	int i;
+
+	for (i=0 ; i<4 ; i++,off += BLOCK_SIZE,page += BLOCK_SIZE) {
+		if (off >= inode->i_size)
+			break;
+		if (!(to = tmpfs_page(inode,off/PAGE_SIZE,1)))
+			break;
+		memcpy((char *) to+off%PAGE_SIZE,(char *) page,BLOCK_SIZE);
+	}
+}
+
+static struct inode_operations tmpfs_inode_operations = {
+	tmpfs_lookup,
+	tmpfs_create,
+	tmpfs_mknod,
+	tmpfs_mkdir,
+	tmpfs_rmdir,
+	tmpfs_unlink,
+	tmpfs_link,
+	tmpfs_read,
+	tmpfs_write,
+	tmpfs_truncate,
+	tmpfs_readpage,
+	tmpfs_writepage,
+	NULL,
+	NULL
+};
+
+/*
+ * Called from put_super() with the super-block locked: the in-memory
+ * inodes are written to the table without get_super(), then everything
+ * is given back.
+ */
+static void tmpfs_put_super(struct super_block * sb)
+{
+	struct m_inode * inode;
+	struct d2_inode * d;
+	int i,nr;
+
+	for (inode = inode_table ; inode < inode_table+NR_INODE ; inode++)
+		if (inode->i_dev == sb->s_dev && inode->i_dirt &&
+		    (d = tmpfs_slot(sb,inode->i_num)))
+			inode_to_slot(inode,d);
+	invalidate_inodes(sb->s_dev);
+	for (i=0 ; i<ADDR_PER_PAGE ; i++) {
+		if (!(d = (struct d2_inode *) sb->s_itable[i]))
+			continue;
+		for (nr=0 ; nr<TMPFS_IPP ; nr++,d++)
+			if (S_ISREG(d->i_mode) || S_ISDIR(d->i_mode))
+				free_data(d->i_zone);
+		free_page(sb->s_itable[i]);
+	}
+	free_page((unsigned long) sb->s_itable);
+	sb->s_itable = NULL;
+}
+
+static struct super_operations tmpfs_super_operations = {
+	tmpfs_read_inode,
+	tmpfs_write_inode,
+	tmpfs_free_inode,
+	tmpfs_put_super
+};
+
+//建立一个空的tmpfs：只有根目录(1号i节点)，其中只有"."和".."
+struct super_block * tmpfs_read_super(struct super_block * s)
+{
+	struct d2_inode * root;
+	struct dir_entry * de;
+
+	if (!(s->s_itable = (unsigned long *) get_free_page()))
+		return NULL;
+	if (!(s->s_itable[0] = get_free_page()) ||
+	    !(de = (struct dir_entry *) get_free_page())) {
+		free_page(s->s_itable[0]);
+		free_page((unsigned long) s->s_itable);
+		s->s_itable = NULL;
+		return NULL;
+	}
+	s->s_ninodes = TMPFS_INODES;
+	s->s_nzones = 0;
+	s->s_imap_blocks = s->s_zmap_blocks = 0;
+	s->s_firstdatazone = 0;
+	s->s_log_zone_size = 2;			//statfs()报告的块大小是一页
+	s->s_max_size = (TMPFS_DIRECT+ADDR_PER_PAGE)*PAGE_SIZE;
+	s->s_magic = TMPFS_MAGIC;
+	s->s_version = 0;
+	s->s_zones = TMPFS_PAGES;
+	s->s_zfree = TMPFS_PAGES-1;
+	s->s_ifree = TMPFS_INODES-1;
+	s->s_op = &tmpfs_super_operations;
+	//0号i节点不用，标记为已占用
+	root = (struct d2_inode *) s->s_itable[0];
+	root->i_nlinks = 1;
+	root += ROOT_INO;
+	root->i_mode = I_DIRECTORY | S_ISVTX | 0777;
+	root->i_uid = current->euid;
+	root->i_gid = current->egid;
+	root->i_nlinks = 2;
+	root->i_size = 2*sizeof (struct dir_entry);
+	root->i_atime = root->i_mtime = root->i_ctime = CURRENT_TIME;
+	root->i_zone[0] = (unsigned long) de;
+	de->inode = ROOT_INO;
+	strcpy(de->name,".");
+	de++;
+	de->inode = ROOT_INO;
+	strcpy(de->name,"..");
+	return s;
+}
@@ -8,66 +8,96 @@
 
 #include <sys/stat.h>
 
-//释放所有一次间接块
-static void free_ind(int dev,int block)
-{
-	struct buffer_head * bh;
-	unsigned short * p;
-	int i;
+/*
+ * Zones are not freed one at a time: consecutive ones (and a file
+ * written in one go is mostly consecutive, indirect blocks included)
+ * are collected into a run and given to free_zones() together.
+ */
+struct zone_run {
+	int dev;
+	int start;
+	int len;
+};
 
-	//首先判断参数的有效性
-	if (!block)
+static void free_zone(struct zone_run * r, int zone)
+{
+	if (r->len && zone == r->start + r->len) {
+		r->len++;
 		return;
-	if (bh=bread(dev,block)) {
-		p = (unsigned short *) bh->b_data;
-		for (i=0;i<512;i++,p++)
-			if (*p)
-				free_block(dev,*p);
-		brelse(bh);
 	}
-	free_block(dev,block);
+	if (r->len)
+		free_zones(r->dev,r->start,r->len);
+	r->start = zone;
+	r->len = 1;
 }
 
-static void free_dind(int dev,int block)
+//释放间接块block以及它管理的全部逻辑块
+//depth是间接的级数：1-一次间接块，2-二次间接块，3-三次间接块(仅v2)
+static void free_ind(struct super_block * sb,struct zone_run * r,int block,int depth)
 {
 	struct buffer_head * bh;
-	unsigned short * p;
+	unsigned long zone;
 	int i;
 
+	//首先判断参数的有效性
 	if (!block)
 		return;
-	if (bh=bread(dev,block)) {
-		p = (unsigned short *) bh->b_data;
-		for (i=0;i<512;i++,p++)
-			if (*p)
-				free_ind(dev,*p);
+	//间接块是其逻辑块中的第一个盘块
+	if (bh=bread(r->dev,block<<sb->s_log_zone_size)) {
+		for (i=0;i<ZONES_PER_BLOCK(sb);i++)
+			if (zone = GET_ZONE(sb,bh->b_data,i)) {
+				if (depth > 1)
+					free_ind(sb,r,zone,depth-1);
+				else
+					free_zone(r,zone);
+			}
 		brelse(bh);
 	}
-	free_block(dev,block);
+	free_zone(r,block);
 }
 
 //截断文件数据函数
 //将节点对应的文件长度截为0,并释放占用的设备空间
 void truncate(struct m_inode * inode)
 {
+	struct super_block * sb;
+	struct zone_run r;
 	int i;
 
 	//首先判断指定i节点有效性
 	if (!(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode)))
 		return;
+	//目录块和间接块可能记录在日志中，它们被释放后日志要重新开始一轮
+	if (S_ISDIR(inode->i_mode) || inode->i_zone[7] || inode->i_zone[8] ||
+	    inode->i_zone[9])
+		journal_revoke(inode->i_dev);
+	//尚未分配磁盘块的数据直接丢弃
+	if (inode->i_ndelay)
+		discard_delayed(inode);
+	//缓存的映射区段即将失效
+	for (i=0;i<NR_MAP_RUNS;i++)
+		inode->i_map[i].len = 0;
+	if (!(sb = get_super(inode->i_dev)))
+		panic("truncate: no super-block");
+	r.dev = inode->i_dev;
+	r.len = 0;
 	//然后释放i节点7个直接逻辑块,并将这个逻辑块项全置0
 	for (i=0;i<7;i++)
 		if (inode->i_zone[i]) {
-			free_block(inode->i_dev,inode->i_zone[i]);
+			free_zone(&r,inode->i_zone[i]);
 			inode->i_zone[i]=0;
 		}
-	//将一级间接块自身占用的逻辑块以及它管理的逻辑块在逻辑位图上对应的位清零
-	free_ind(inode->i_dev,inode->i_zone[7]);
-	//将二级间接块自身占用的逻辑块以及它管理的逻辑块在逻辑位图上对应的位清零
-	free_dind(inode->i_dev,inode->i_zone[8]);
-	inode->i_zone[7] = inode->i_zone[8] = 0;		//逻辑块项7 8置零
+	//将各级间接块自身占用的逻辑块以及它们管理的逻辑块在逻辑位图上对应的位清零
+	//i_zone[7]是一次间接块，i_zone[8]是二次间接块，i_zone[9]是三次间接块(只在v2中使用)
+	for (i=7;i<10;i++) {
+		free_ind(sb,&r,inode->i_zone[i],i-6);
+		inode->i_zone[i] = 0;
+	}
+	if (r.len)
+		free_zones(r.dev,r.start,r.len);
 	inode->i_size = 0;		//文件大小置零
 	inode->i_dirt = 1;		//置节点已修改标志
+	inode->i_dsync = 1;
 	inode->i_mtime = inode->i_ctime = CURRENT_TIME;
 }
 
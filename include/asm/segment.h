@@ -46,6 +46,79 @@ extern inline void put_fs_long(unsigned long val,unsigned long * addr)
 __asm__ ("movl %0,%%fs:%1"::"r" (val),"m" (*addr));
 }
 
+//在内核数据段和用户数据段(fs)之间成块复制n字节
+//先用movsb复制到目的地址按长字对齐，中间用rep movsl按长字复制，最后用movsb复制剩下的零头
+//memcpy_tofs()把内核空间from处的数据复制到用户空间to处，需要暂时让es指向用户数据段
+extern inline void memcpy_tofs(void * to, const void * from, unsigned long n)
+{
+	unsigned long head = -(unsigned long) to & 3;
+	int d0,d1,d2,d3;
+
+	if (head > n)
+		head = n;
+__asm__ __volatile__("cld\n\t"
+	"push %%es\n\t"
+	"push %%fs\n\t"
+	"pop %%es\n\t"
+	"rep ; movsb\n\t"
+	"movl %%eax,%%ecx\n\t"
+	"shrl $2,%%ecx\n\t"
+	"rep ; movsl\n\t"
+	"movl %%eax,%%ecx\n\t"
+	"andl $3,%%ecx\n\t"
+	"rep ; movsb\n\t"
+	"pop %%es"
+	:"=c" (d0),"=D" (d1),"=S" (d2),"=a" (d3)
+	:"0" (head),"1" ((long) to),"2" ((long) from),"3" (n-head)
+	:"memory");
+}
+
+//memcpy_fromfs()把用户空间from处的数据复制到内核空间to处，源操作数加fs段前缀即可
+extern inline void memcpy_fromfs(void * to, const void * from, unsigned long n)
+{
+	unsigned long head = -(unsigned long) to & 3;
+	int d0,d1,d2,d3;
+
+	if (head > n)
+		head = n;
+__asm__ __volatile__("cld\n\t"
+	"rep ; fs ; movsb\n\t"
+	"movl %%eax,%%ecx\n\t"
+	"shrl $2,%%ecx\n\t"
+	"rep ; fs ; movsl\n\t"
+	"movl %%eax,%%ecx\n\t"
+	"andl $3,%%ecx\n\t"
+	"rep ; fs ; movsb"
+	:"=c" (d0),"=D" (d1),"=S" (d2),"=a" (d3)
+	:"0" (head),"1" ((long) to),"2" ((long) from),"3" (n-head)
+	:"memory");
+}
+
+//把用户空间to处的n字节清零，对齐方式同memcpy_tofs()
+extern inline void clear_fs(void * to, unsigned long n)
+{
+	unsigned long head = -(unsigned long) to & 3;
+	int d0,d1,d2;
+
+	if (head > n)
+		head = n;
+__asm__ __volatile__("cld\n\t"
+	"push %%es\n\t"
+	"push %%fs\n\t"
+	"pop %%es\n\t"
+	"rep ; stosb\n\t"
+	"movl %%edx,%%ecx\n\t"
+	"shrl $2,%%ecx\n\t"
+	"rep ; stosl\n\t"
+	"movl %%edx,%%ecx\n\t"
+	"andl $3,%%ecx\n\t"
+	"rep ; stosb\n\t"
+	"pop %%es"
+	:"=c" (d0),"=D" (d1),"=d" (d2)
+	:"a" (0),"0" (head),"1" ((long) to),"2" (n-head)
+	:"memory");
+}
+
 /*
  * Someone who knows GNU asm better than I should double check the followig.
  * It seems to work, but I don't know if I'm doing something subtly wrong.
@@ -15,6 +15,7 @@
 #define O_APPEND	02000
 #define O_NONBLOCK	04000	/* not fcntl */
 #define O_NDELAY	O_NONBLOCK
+#define O_DIRECT	010000	/* whole aligned blocks bypass the buffer cache */
 
 /* Defines for fcntl-commands. Note that currently
  * locking isn't supported, and other things aren't really
@@ -28,6 +29,8 @@
 #define F_GETLK		5	/* not implemented */
 #define F_SETLK		6
 #define F_SETLKW	7
+#define F_GETPIPE_SZ	8	/* pipe buffer size */
+#define F_SETPIPE_SZ	9
 
 /* for F_[GET|SET]FL */
 #define FD_CLOEXEC	1	/* actually anything with low bit set goes */
@@ -20,9 +20,12 @@
  * 5 - /dev/tty					tty终端设备
  * 6 - /dev/lp					打印设备
  * 7 - unnamed pipes			没有命名的管道s
+ *     and memory file systems	以及不用块设备的文件系统(tmpfs)
  */
 
-#define IS_SEEKABLE(x) ((x)>=1 && (x)<=3)
+#define UNNAMED_MAJOR 7
+
+#define IS_SEEKABLE(x) (((x)>=1 && (x)<=3) || (x)==UNNAMED_MAJOR)
 
 #define READ 0
 #define WRITE 1
@@ -37,33 +40,70 @@ void buffer_init(long buffer_end);
 #define NAME_LEN 14
 #define ROOT_INO 1
 
-#define I_MAP_SLOTS 8
-#define Z_MAP_SLOTS 8
 #define SUPER_MAGIC 0x137F
+#define SUPER_MAGIC_V2 0x2468		//minix v2文件系统(32位逻辑块号)
+#define TMPFS_MAGIC 0x1994			//tmpfs(数据在内存页面中)
 
-#define NR_OPEN 20
+#define NR_OPEN 256
+#define NR_OPEN_DEFAULT 20
 #define NR_INODE 32
-#define NR_FILE 64
+#define NR_FILE 1024
 #define NR_SUPER 8
 #define NR_HASH 307
 #define NR_BUFFERS nr_buffers
 #define BLOCK_SIZE 1024
 #define BLOCK_SIZE_BITS 10
+#define DIRECT_BATCH 32				//O_DIRECT一次发出的块数(合并成一个请求)
 #ifndef NULL
 #define NULL ((void *) 0)
 #endif
 
-#define INODES_PER_BLOCK ((BLOCK_SIZE)/(sizeof (struct d_inode)))
+/*
+ * The two on-disk formats differ in the size of a disk inode and of a
+ * zone number. s_version in the super-block tells which one a device
+ * uses; the in-memory inode is the same for both.
+ */
+#define INODE_SIZE(sb) ((sb)->s_version==2 ? \
+	sizeof (struct d2_inode) : sizeof (struct d_inode))
+#define INODES_PER_BLOCK(sb) ((BLOCK_SIZE)/INODE_SIZE(sb))
+#define ZONE_BITS(sb) ((sb)->s_version==2 ? 8 : 9)		//log(每块含有的逻辑块号数)
+#define ZONES_PER_BLOCK(sb) (1<<ZONE_BITS(sb))
+//取/设置间接块数据区data中第n项逻辑块号
+#define GET_ZONE(sb,data,n) ((sb)->s_version==2 ? \
+	((unsigned long *) (data))[n] : ((unsigned short *) (data))[n])
+#define SET_ZONE(sb,data,n,zone) ((sb)->s_version==2 ? \
+	(((unsigned long *) (data))[n] = (zone)) : \
+	(((unsigned short *) (data))[n] = (zone)))
 #define DIR_ENTRIES_PER_BLOCK ((BLOCK_SIZE)/(sizeof (struct dir_entry)))
 
+#define IS_RDONLY(inode) fs_rdonly((inode)->i_dev)	//i节点所在文件系统是否只读
+
+//管道缓冲区是由i_pipe_page[]中PIPE_PAGES个页面组成的环，页面数是2的幂
+#define PIPE_DEF_PAGES 4								//新建管道的页面数
+#define PIPE_MAX_PAGES 8								//管道最多的页面数
 #define PIPE_HEAD(inode) ((inode).i_zone[0])		//管道头
 #define PIPE_TAIL(inode) ((inode).i_zone[1])		//管道尾
-#define PIPE_SIZE(inode) ((PIPE_HEAD(inode)-PIPE_TAIL(inode))&(PAGE_SIZE-1))	//管道大小
+#define PIPE_PAGES(inode) ((inode).i_zone[2])		//管道页面数
+#define PIPE_BUF_SIZE(inode) (PIPE_PAGES(inode)*PAGE_SIZE)	//管道缓冲区长度
+#define PIPE_SIZE(inode) ((PIPE_HEAD(inode)-PIPE_TAIL(inode))&(PIPE_BUF_SIZE(inode)-1))	//管道大小
 #define PIPE_EMPTY(inode) (PIPE_HEAD(inode)==PIPE_TAIL(inode))	//管道空
-#define PIPE_FULL(inode) (PIPE_SIZE(inode)==(PAGE_SIZE-1))	//管道满
+#define PIPE_FULL(inode) (PIPE_SIZE(inode)==(PIPE_BUF_SIZE(inode)-1))	//管道满
+#define PIPE_FREE(inode) (PIPE_BUF_SIZE(inode)-1-PIPE_SIZE(inode))	//管道空闲字节数
+#define PIPE_WAKE(inode) (PIPE_BUF_SIZE(inode)/2)	//空闲空间达到此值才唤醒写者
+//缓冲区中位置pos处的内存地址
+#define PIPE_ADDR(inode,pos) \
+((char *) (inode).i_pipe_page[(pos)>>12] + ((pos)&(PAGE_SIZE-1)))
 #define INC_PIPE(head) \
 __asm__("incl %0\n\tandl $4095,%0"::"m" (head))
 
+/*
+ * Delayed allocation: data written to holes sits in buffers hashed under
+ * a pseudo-device (major 0, minor = inode-table slot + 1) and keyed by the
+ * logical block number, until alloc_delayed() gives it a disk address.
+ */
+#define DELAY_DEV(inode) ((inode)-inode_table+1)	//延迟分配缓冲块使用的伪设备号
+#define IS_DELAY_DEV(dev) ((dev) && !MAJOR(dev))
+
 typedef char buffer_block[BLOCK_SIZE];				//块缓冲区
 
 //缓冲块头数据结构
@@ -81,6 +121,9 @@ struct buffer_head {
 	struct buffer_head * b_next;								//hash队列上下一块
 	struct buffer_head * b_prev_free;						//空闲表上前一块
 	struct buffer_head * b_next_free;						//空闲表上下一块
+	struct buffer_head * b_reqnext;							//同一请求项中的下一块
+	unsigned long b_jtrans;		//所在日志事务的序号，0表示不在事务中
+	unsigned short b_jlog;		//上次提交时在日志中的位置(日志块序号)，0表示没有
 };
 
 //磁盘上的索引节点(i节点)数据结构,与下述定义相同
@@ -94,6 +137,28 @@ struct d_inode {
 	unsigned short i_zone[9];
 };
 
+//minix v2磁盘i节点，逻辑块号是32位的，i_zone[9]是三次间接块
+struct d2_inode {
+	unsigned short i_mode;
+	unsigned short i_nlinks;
+	unsigned short i_uid;
+	unsigned short i_gid;
+	unsigned long i_size;
+	unsigned long i_atime;
+	unsigned long i_mtime;
+	unsigned long i_ctime;
+	unsigned long i_zone[10];
+};
+
+#define NR_MAP_RUNS 4
+
+//i节点中缓存的一段连续映射：文件数据块block起的len块对应盘块zone起的len块
+struct map_run {
+	unsigned long block;
+	unsigned long zone;
+	unsigned short len;
+};
+
 //内存中的i节点结构
 struct m_inode {
 	unsigned short i_mode;			//文件类型和属性(rwx位)
@@ -102,7 +167,7 @@ struct m_inode {
 	unsigned long i_mtime;			//修改时间(自1970.1.1:0算起，秒)
 	unsigned char i_gid;				//组id(文件拥有者所在的组)
 	unsigned char i_nlinks;				//文件目录项链接数
-	unsigned short i_zone[9];			//直接(0-6)、间接(7)或双重间接(8)逻辑块
+	unsigned long i_zone[10];			//直接(0-6)、间接(7)、双重间接(8)或三重间接(9，仅v2)逻辑块
 /* these are in memory also */
 	struct task_struct * i_wait;			//等待i节点的进程
 	unsigned long i_atime;				//最后访问时间
@@ -116,6 +181,16 @@ struct m_inode {
 	unsigned char i_mount;				//安装标志
 	unsigned char i_seek;					//搜寻标志
 	unsigned char i_update;				//更新标志
+	unsigned char i_dsync;				//长度或块映射已修改(fdatasync()也要写i节点)
+	unsigned short i_ndelay;			//尚未分配磁盘块的延迟写缓冲块数
+	unsigned short i_nindir;			//为延迟写块将要用到的间接块预留的块数
+	struct task_struct * i_dalloc;		//正在alloc_delayed()中为其分配磁盘块的进程
+	unsigned char i_reclaim;			//已删除，等待reclaim_inodes()释放其磁盘块
+	unsigned long i_dfree;				//目录中可能空闲的最低目录项号，之前的都在用
+	struct map_run i_map[NR_MAP_RUNS];	//最近用到的间接块映射区段
+	unsigned char i_mapnext;			//下一个要替换的区段
+	unsigned long i_pipe_page[PIPE_MAX_PAGES];	//管道缓冲区页面
+	struct inode_operations * i_op;		//所在文件系统的i节点操作(管道为NULL)
 };
 
 //文件结构(用于在文件句柄与i节点之间建立关系)
@@ -125,21 +200,35 @@ struct file {
 	unsigned short f_count;			//对应文件引用计数值
 	struct m_inode * f_inode;		//指向对应i节点
 	off_t f_pos;						//文件位置(读写偏移值s)
+	struct file * f_next;				//空闲文件结构链表指针
+};
+
+/*
+ * A process starts with the NR_OPEN_DEFAULT descriptors kept in its
+ * task_struct. The first time it needs more, they are moved to a page
+ * holding a table of the full NR_OPEN size.
+ */
+struct fd_table {
+	struct file * filp[NR_OPEN];
+	unsigned long close_on_exec[NR_OPEN/32];
 };
 
 //内存中磁盘超级块结构
 struct super_block {
 	unsigned short s_ninodes;			//节点数
-	unsigned short s_nzones;			//逻辑块数
+	unsigned short s_nzones;			//逻辑块数(v1)
 	unsigned short s_imap_blocks;		//i节点位图所占用的数据块数
 	unsigned short s_zmap_blocks;		//逻辑块位图所占用的数据块数
 	unsigned short s_firstdatazone;		//第一个数据逻辑块号
 	unsigned short s_log_zone_size;		//log(数据块数/逻辑块)
 	unsigned long s_max_size;			//文件最大长度
 	unsigned short s_magic;				//文件系统魔数
+	unsigned short s_state;				//(v2)
+	unsigned long s_zones;				//逻辑块数(v2，v1安装时由s_nzones设置)
 /* These are only in memory */
-	struct buffer_head * s_imap[8];			//i节点位图缓冲块指针数组(占用8块，可表示64MB)
-	struct buffer_head * s_zmap[8];			//逻辑块位图缓冲块指针数据(占用8块)
+	struct buffer_head ** s_imap;			//i节点位图缓冲块指针数组(共s_imap_blocks项)
+	struct buffer_head ** s_zmap;			//逻辑块位图缓冲块指针数组(共s_zmap_blocks项)
+	unsigned char s_version;				//文件系统格式：1或2
 	unsigned short s_dev;					//超级块所在的设备号
 	struct m_inode * s_isup;				//被安装的文件系统根目录的i节点
 	struct m_inode * s_imount;			//被安装到的i节点
@@ -148,6 +237,87 @@ struct super_block {
 	unsigned char s_lock;					//被锁定标志
 	unsigned char s_rd_only;			//只读标志
 	unsigned char s_dirt;				//已修改标志
+	unsigned long s_zfree;				//空闲逻辑块数(安装时统计，分配释放时随时更新)
+	unsigned long s_ifree;				//空闲i节点数
+	unsigned long s_zdelay;				//已答应给延迟写数据但还未分配的逻辑块数
+	struct super_operations * s_op;		//文件系统类型的超级块操作
+	unsigned long * s_itable;			//tmpfs：存放i节点表各页面地址的页面
+	struct journal * s_journal;			//元数据日志，没有则为NULL
+};
+
+/*
+ * The metadata journal of a mounted minix file system (fs/journal.c),
+ * kept in a page. The log is the file /.journal: block 0 is a header,
+ * transactions follow from block 1 on.
+ */
+#define J_MIN_LOG 16				//日志文件至少的块数
+#define J_MAX_LOG 256				//最多使用的日志块数
+#define J_MAX_TRANS 192				//一个事务最多的缓冲块数
+
+struct journal {
+	struct m_inode * j_inode;		//日志文件的i节点
+	int j_nlog;						//日志块数
+	int j_head;						//下一个事务从日志的第几块开始
+	unsigned long j_seq;			//当前事务的序号
+	unsigned long j_start;			//当前事务开始的时间(滴答)
+	int j_handles;					//正在进行的修改操作数
+	int j_full;						//其中因事务已满而等待提交的操作数
+	int j_committing;				//正在提交
+	struct task_struct * j_committer;	//提交者
+	int j_revoke;					//释放过可能在日志中的块
+	int j_held;						//有留给下一个事务的块
+	struct task_struct * j_wait;
+	int j_n;						//当前事务中的缓冲块数
+	struct buffer_head * j_bh[J_MAX_TRANS];		//当前事务
+	struct buffer_head * j_cbh[J_MAX_TRANS];	//正在提交的事务
+	struct buffer_head * j_lb[J_MAX_TRANS+2];	//提交时使用的日志缓冲块
+	unsigned long j_blocks[J_MAX_LOG];			//各日志块在设备上的块号
+};
+
+/*
+ * Everything that depends on how a file system keeps its data goes
+ * through these tables, so namei(), read(), write(), the page-fault
+ * code etc. work on any type. Each inode points at the operations of
+ * its file system; pipes have none. The directory operations are
+ * called with the name still in user space, after the caller has
+ * checked the permissions, and don't iput() dir. create() is only
+ * called for a name that lookup() didn't find.
+ */
+struct inode_operations {
+	int (*lookup)(struct m_inode * dir,const char * name,int len,
+		struct m_inode ** res_inode);
+	int (*create)(struct m_inode * dir,const char * name,int len,int mode,
+		struct m_inode ** res_inode);
+	int (*mknod)(struct m_inode * dir,const char * name,int len,int mode,
+		int rdev);
+	int (*mkdir)(struct m_inode * dir,const char * name,int len,int mode);
+	int (*rmdir)(struct m_inode * dir,const char * name,int len);
+	int (*unlink)(struct m_inode * dir,const char * name,int len);
+	int (*link)(struct m_inode * oldinode,struct m_inode * dir,
+		const char * name,int len);
+	int (*read)(struct m_inode * inode,struct file * filp,char * buf,int count);
+	int (*write)(struct m_inode * inode,struct file * filp,char * buf,int count);
+	void (*truncate)(struct m_inode * inode);
+	//读入(写回)文件中从off(BLOCK_SIZE的倍数)开始的一页数据，用于缺页和文件映射
+	int (*readpage)(struct m_inode * inode,unsigned long off,unsigned long page);
+	void (*writepage)(struct m_inode * inode,unsigned long off,unsigned long page);
+	int (*fsync)(struct m_inode * inode,int datasync);		//NULL表示无需回写
+	//为从off开始的pages页发出预读请求，不等待读完(NULL表示不预读)
+	void (*readahead)(struct m_inode * inode,unsigned long off,int pages);
+};
+
+struct super_operations {
+	void (*read_inode)(struct m_inode * inode);
+	void (*write_inode)(struct m_inode * inode);
+	void (*free_inode)(struct m_inode * inode);		//链接数和引用数都为0时释放i节点
+	void (*put_super)(struct super_block * sb);
+};
+
+//文件系统类型。requires_dev为0的类型安装时用类型名代替设备名
+struct file_system_type {
+	struct super_block * (*read_super)(struct super_block * sb);
+	char * name;
+	int requires_dev;
 };
 
 //与上述定义相同
@@ -161,6 +331,8 @@ struct d_super_block {
 	unsigned short s_log_zone_size;
 	unsigned long s_max_size;
 	unsigned short s_magic;
+	unsigned short s_state;
+	unsigned long s_zones;
 };
 
 //文件目录项结构
@@ -170,7 +342,6 @@ struct dir_entry {
 };
 
 extern struct m_inode inode_table[NR_INODE];
-extern struct file file_table[NR_FILE];
 extern struct super_block super_block[NR_SUPER];
 extern struct buffer_head * start_buffer;
 extern int nr_buffers;
@@ -180,31 +351,68 @@ extern int floppy_change(unsigned int nr);
 extern int ticks_to_floppy_on(unsigned int dev);
 extern void floppy_on(unsigned int dev);
 extern void floppy_off(unsigned int dev);
+extern struct inode_operations minix_inode_operations;
+extern struct super_operations minix_super_operations;
+extern struct super_block * minix_read_super(struct super_block * sb);
+extern struct super_block * tmpfs_read_super(struct super_block * sb);
 extern void truncate(struct m_inode * inode);
 extern void sync_inodes(void);
+extern void invalidate_inodes(int dev);
+extern int sync_inode(struct m_inode * inode);
+extern int read_disk_inode(struct super_block * sb, int nr,
+	struct m_inode * inode);
+extern void journal_start(int dev);
+extern void journal_stop(int dev);
+extern void journal_dirty(struct buffer_head * bh);
+extern void journal_forget(struct buffer_head * bh);
+extern void journal_revoke(int dev);
+extern int journal_commit(int dev);
+extern void sync_journals(void);
+extern int journal_load(struct super_block * sb);
+extern void journal_release(struct super_block * sb);
+extern int is_journal(struct m_inode * inode);
 extern void wait_on(struct m_inode * inode);
 extern int bmap(struct m_inode * inode,int block);
 extern int create_block(struct m_inode * inode,int block);
+extern struct buffer_head * get_delayed(struct m_inode * inode,int block,
+	int create);
+extern void alloc_delayed(struct m_inode * inode);
+extern void discard_delayed(struct m_inode * inode);
 extern struct m_inode * namei(const char * pathname);
 extern int open_namei(const char * pathname, int flag, int mode,
 	struct m_inode ** res_inode);
 extern void iput(struct m_inode * inode);
+extern int reclaim_inodes(int dev);
 extern struct m_inode * iget(int dev,int nr);
 extern struct m_inode * get_empty_inode(void);
 extern struct m_inode * get_pipe_inode(void);
+extern int pipe_set_pages(struct m_inode * inode, int pages);
+extern struct file * get_empty_filp(void);
+extern void put_filp(struct file * f);
+extern int get_unused_fd(int fd);
+extern int copy_files(struct task_struct * p);
+extern void exit_files(void);
 extern struct buffer_head * get_hash_table(int dev, int block);
 extern struct buffer_head * getblk(int dev, int block);
 extern void ll_rw_block(int rw, struct buffer_head * bh);
+extern int is_read_only(int dev);
+extern void set_device_ro(int dev, int flag);
 extern void brelse(struct buffer_head * buf);
 extern struct buffer_head * bread(int dev,int block);
 extern void bread_page(unsigned long addr,int dev,int b[4]);
 extern struct buffer_head * breada(int dev,int block,...);
-extern int new_block(int dev);
+extern struct buffer_head * bread_zone(int dev,int block);
+extern int direct_rw(int rw, int dev, int * nr, int n, char * buf);
+extern void remap_buffer(struct buffer_head * bh,int dev,int block);
+extern int new_block(int dev,int reserved);
+extern int new_zones(int dev,int goal,int * count);
 extern void free_block(int dev, int block);
-extern struct m_inode * new_inode(int dev);
+extern void free_zones(int dev, int block, int count);
+extern struct m_inode * new_inode(int dev,int near);
 extern void free_inode(struct m_inode * inode);
 extern int sync_dev(int dev);
 extern struct super_block * get_super(int dev);
+extern int fs_rdonly(int dev);
 extern int ROOT_DEV;
 
 extern void mount_root(void);
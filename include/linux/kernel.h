@@ -5,7 +5,7 @@ void verify_area(void * addr,int count);
 volatile void panic(const char * str);
 int printf(const char * fmt, ...);
 int printk(const char * fmt, ...);
-int tty_write(unsigned ch,char * buf,int count);
+int tty_write(unsigned ch,char * buf,int count,unsigned short flags);
 void * malloc(unsigned int size);
 void free_s(void * obj, int size);
 
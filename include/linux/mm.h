@@ -3,8 +3,37 @@
 
 #define PAGE_SIZE 4096
 
+//进程逻辑地址空间中留给文件映射(mmap)的区域：32MB-48MB
+//brk不能越过MMAP_START，栈从64MB处向下增长
+#define MMAP_START 0x2000000
+#define MMAP_END 0x3000000
+#define NR_MMAP 8						//每个进程最多的映射区数
+#define NR_CACHED_PAGES 256				//页面缓存最多保留的执行文件页数(1MB)
+#define EXEC_PREFAULT 4					//execve时预先装入的代码页数，0表示不预装
+
+//文件映射区结构，m_start和m_end是进程逻辑地址(页对齐)，m_offset是对应的文件内偏移
+//m_inode为NULL表示该项空闲
+struct mmap_struct {
+	unsigned long m_start;
+	unsigned long m_end;
+	unsigned long m_offset;
+	unsigned short m_prot;
+	unsigned short m_flags;
+	struct m_inode * m_inode;
+};
+
 extern unsigned long get_free_page(void);
 extern unsigned long put_page(unsigned long page,unsigned long address);
 extern void free_page(unsigned long addr);
+extern unsigned long get_user_page(unsigned long address);
+extern unsigned long put_user_page(unsigned long page,unsigned long address);
+extern unsigned long pin_user_page(unsigned long addr, int write);
+extern int page_shared(unsigned long page);
+extern struct mmap_struct * find_mmap(unsigned long addr);
+extern void unmap_pages(struct mmap_struct * m,unsigned long from,unsigned long to);
+extern void exit_mmap(void);
+extern void sync_mmap(struct m_inode * inode);
+extern void invalidate_pages(int dev, int ino);
+extern void prefault_text(void);
 
 #endif
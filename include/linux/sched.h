@@ -12,8 +12,11 @@
 #include <linux/mm.h>
 #include <signal.h>
 
-#if (NR_OPEN > 32)
-#error "Currently the close-on-exec-flags are in one word, max 32 files/proc"
+#if (NR_OPEN_DEFAULT > 32)
+#error "The built-in close-on-exec-flags are in one word, max 32 files/proc"
+#endif
+#if (NR_OPEN % 32) || (NR_OPEN > FD_SETSIZE)
+#error "NR_OPEN must be a multiple of 32 and fit in an fd_set"
 #endif
 
 #define TASK_RUNNING		0
@@ -33,7 +36,7 @@ extern void sched_init(void);
 extern void schedule(void);
 extern void trap_init(void);
 extern void panic(const char * str);
-extern int tty_write(unsigned minor,char * buf,int count);
+extern int tty_write(unsigned minor,char * buf,int count,unsigned short flags);
 
 typedef int (*fn_ptr)();
 
@@ -97,6 +100,7 @@ struct task_struct {
 	unsigned short uid,euid,suid;	//用户标识号(用户id)，有效用户id，保存的用户id
 	unsigned short gid,egid,sgid;	//组标识号(组id)，有效组id，保存的组id
 	long alarm;					//报警定时值(滴答数)
+	long timeout;				//睡眠超时时刻(滴答数)，0表示没有超时
 	long utime;					//用户态运行时间(滴答数)
 	long stime;					//系统态运行时间(滴答数)
 	long cutime;					//子进程用户态运行时间
@@ -109,8 +113,13 @@ struct task_struct {
 	struct m_inode * pwd;			//当前工作目录i节点结构
 	struct m_inode * root;				//根目录i节点结构
 	struct m_inode * executable;		//执行文件i节点结构
-	unsigned long close_on_exec;		//执行时关闭文件句柄位图标志
-	struct file * filp[NR_OPEN];			//进程使用的文件表结构
+	unsigned long * close_on_exec;		//执行时关闭文件句柄位图标志
+	struct file ** filp;				//进程使用的文件表结构，共max_fds项
+	int max_fds;						//当前文件句柄表的大小
+	int next_fd;						//小于该值的句柄都已被使用
+	unsigned long init_close_on_exec;	//进程自带的前NR_OPEN_DEFAULT个句柄的表
+	struct file * init_filp[NR_OPEN_DEFAULT];
+	struct mmap_struct mmap[NR_MMAP];	//文件映射区
 /* ldt for this task 0 - zero 1 - cs 2 - ds&ss */
 	struct desc_struct ldt[3];			//本任务的局部表描述符。0-空，1-代码段cs，2-数据和堆栈段ss&ss
 /* tss for this task */
@@ -129,10 +138,12 @@ struct task_struct {
 /* ec,brk... */	0,0,0,0,0,0, \
 /* pid etc.. */	0,-1,0,0,0, \			//进程号0
 /* uid etc */	0,0,0,0,0,0, \
-/* alarm */	0,0,0,0,0,0, \
+/* alarm */	0,0,0,0,0,0,0, \
 /* math */	0, \
-/* fs info */	-1,0022,NULL,NULL,NULL,0, \
-/* filp */	{NULL,}, \
+/* fs info */	-1,0022,NULL,NULL,NULL, \
+/* filp */	&init_task.task.init_close_on_exec,init_task.task.init_filp, \
+		NR_OPEN_DEFAULT,0,0,{NULL,}, \
+/* mmap */	{{0,},}, \
 	{ \
 		{0,0}, \
 /* ldt */	{0x9f,0xc0fa00}, \		//代码段长640KB，基址0x0，G=1,D=1,DPL=3,P=1,TYPE=0x0a					
@@ -154,6 +165,13 @@ extern long startup_time;
 
 #define CURRENT_TIME (startup_time+jiffies/HZ)
 
+#define FD_CLOEXEC_SET(fd) \
+	(current->close_on_exec[(fd)>>5] |= 1UL<<((fd)&31))
+#define FD_CLOEXEC_CLR(fd) \
+	(current->close_on_exec[(fd)>>5] &= ~(1UL<<((fd)&31)))
+#define FD_CLOEXEC_ISSET(fd) \
+	((current->close_on_exec[(fd)>>5]>>((fd)&31))&1)
+
 extern void add_timer(long jiffies, void (*fn)(void));
 extern void sleep_on(struct task_struct ** p);
 extern void interruptible_sleep_on(struct task_struct ** p);
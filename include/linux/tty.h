@@ -71,8 +71,8 @@ void rs_init(void);
 void con_init(void);
 void tty_init(void);
 
-int tty_read(unsigned c, char * buf, int n);
-int tty_write(unsigned c, char * buf, int n);
+int tty_read(unsigned c, char * buf, int n, unsigned short flags);
+int tty_write(unsigned c, char * buf, int n, unsigned short flags);
 
 void rs_write(struct tty_struct * tty);
 void con_write(struct tty_struct * tty);
@@ -0,0 +1,26 @@
+#ifndef _SYS_MMAN_H
+#define _SYS_MMAN_H
+
+#include <sys/types.h>
+
+#define PROT_NONE	0
+#define PROT_READ	1
+#define PROT_WRITE	2
+#define PROT_EXEC	4
+
+#define MAP_SHARED	1
+#define MAP_PRIVATE	2
+#define MAP_TYPE	0x0f
+#define MAP_FIXED	0x10
+
+#define MAP_FAILED	((void *) -1)
+
+/*
+ * The mmap system call takes a pointer to its six arguments
+ * (addr, len, prot, flags, fd, offset), as int 0x80 only passes three.
+ */
+extern void * mmap(void * addr, size_t len, int prot, int flags,
+	int fildes, off_t off);
+extern int munmap(void * addr, size_t len);
+
+#endif
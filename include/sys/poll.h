@@ -0,0 +1,20 @@
+#ifndef _SYS_POLL_H
+#define _SYS_POLL_H
+
+struct pollfd {
+	int fd;
+	short events;
+	short revents;
+};
+
+#define POLLIN		0x0001	/* data may be read without blocking */
+#define POLLPRI		0x0002	/* never set: there is no urgent data */
+#define POLLOUT		0x0004	/* data may be written without blocking */
+#define POLLERR		0x0008
+#define POLLHUP		0x0010	/* pipe has no writers left */
+#define POLLNVAL	0x0020	/* fd is not open */
+
+/* timeout is in milliseconds, -1 waits for ever */
+extern int poll(struct pollfd * fds, unsigned long nfds, int timeout);
+
+#endif
@@ -17,6 +17,17 @@ struct stat {
 	time_t	st_ctime;
 };
 
+/* one entry of a directory as returned by readdirplus() */
+struct dirplus {
+	ino_t	d_ino;
+	umode_t	d_mode;
+	uid_t	d_uid;
+	gid_t	d_gid;
+	off_t	d_size;
+	time_t	d_mtime;
+	char	d_name[16];	/* NUL-terminated */
+};
+
 #define S_IFMT  00170000
 #define S_IFREG  0100000
 #define S_IFBLK  0060000
@@ -52,6 +63,7 @@ extern int chmod(const char *_path, mode_t mode);
 extern int fstat(int fildes, struct stat *stat_buf);
 extern int mkdir(const char *_path, mode_t mode);
 extern int mkfifo(const char *_path, mode_t mode);
+extern int readdirplus(int fildes, struct dirplus *buf, int count);
 extern int stat(const char *filename, struct stat *stat_buf);
 extern mode_t umask(mode_t mask);
 
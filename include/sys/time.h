@@ -0,0 +1,19 @@
+#ifndef _SYS_TIME_H
+#define _SYS_TIME_H
+
+#include <sys/types.h>
+
+struct timeval {
+	long tv_sec;		/* seconds */
+	long tv_usec;		/* microseconds */
+};
+
+/*
+ * The select system call takes a pointer to its five arguments
+ * (nfds, readfds, writefds, exceptfds, timeout), as int 0x80 only
+ * passes three.
+ */
+extern int select(int nfds, fd_set * readfds, fd_set * writefds,
+	fd_set * exceptfds, struct timeval * timeout);
+
+#endif
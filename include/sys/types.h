@@ -36,6 +36,24 @@ typedef unsigned short ushort;
 typedef struct { int quot,rem; } div_t;
 typedef struct { long quot,rem; } ldiv_t;
 
+/* descriptor sets for select() */
+#define FD_SETSIZE		256
+#define NFDBITS			(8 * sizeof(unsigned long))
+
+typedef struct fd_set {
+	unsigned long fds_bits[FD_SETSIZE / NFDBITS];
+} fd_set;
+
+#define FD_SET(fd,fdsetp) \
+	((fdsetp)->fds_bits[(fd)/NFDBITS] |= (1UL<<((fd)%NFDBITS)))
+#define FD_CLR(fd,fdsetp) \
+	((fdsetp)->fds_bits[(fd)/NFDBITS] &= ~(1UL<<((fd)%NFDBITS)))
+#define FD_ISSET(fd,fdsetp) \
+	(((fdsetp)->fds_bits[(fd)/NFDBITS] >> ((fd)%NFDBITS)) & 1)
+#define FD_ZERO(fdsetp) \
+	do { int __i; for (__i = 0; __i < FD_SETSIZE / NFDBITS; __i++) \
+		(fdsetp)->fds_bits[__i] = 0; } while (0)
+
 struct ustat {
 	daddr_t f_tfree;
 	ino_t f_tinode;
@@ -0,0 +1,18 @@
+#ifndef _SYS_VFS_H
+#define _SYS_VFS_H
+
+#include <sys/types.h>
+
+struct statfs {
+	long f_type;
+	long f_bsize;
+	long f_blocks;
+	long f_bfree;
+	long f_files;
+	long f_ffree;
+	long f_namelen;
+};
+
+extern int statfs(const char * filename, struct statfs * buf);
+
+#endif
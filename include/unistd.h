@@ -129,6 +129,15 @@
 #define __NR_ssetmask	69
 #define __NR_setreuid	70
 #define __NR_setregid	71
+#define __NR_statfs	72
+#define __NR_mmap	73
+#define __NR_munmap	74
+#define __NR_sendfile	75
+#define __NR_select	76
+#define __NR_poll	77
+#define __NR_fsync	78
+#define __NR_fdatasync	79
+#define __NR_readdirplus	80
 
 #define _syscall0(type,name) \
 type name(void) \
@@ -249,5 +258,9 @@ int dup2(int oldfd, int newfd);
 int getppid(void);
 pid_t getpgrp(void);
 pid_t setsid(void);
+int sendfile(int out_fd, int in_fd, off_t count);
+int fsync(int fildes);
+int fdatasync(int fildes);
+int readdirplus(int fildes, struct dirplus * buf, int count);
 
 #endif
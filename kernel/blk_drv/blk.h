@@ -30,6 +30,7 @@ struct request {
 	char * buffer;					//数据缓冲区
 	struct task_struct * waiting;	//任务等待操作执行完成的地方???
 	struct buffer_head * bh;		//缓冲区头指针
+	struct buffer_head * bhtail;	//合并进来的最后一个缓冲块(经b_reqnext链接)
 	struct request * next;			//指向下一个请求项
 };
 
@@ -114,17 +115,22 @@ extern inline void unlock_buffer(struct buffer_head * bh)
 //如果有效则根据参数值设置缓冲区数据更新标志，并解锁该缓冲区
 //最后唤醒等待该请求项的进程以及等待空闲请求项出现的进程，
 //释放并从请求项链表中删除本请求项，并把当前请求项指针指向下一请求项
+//请求项中可能链有多个缓冲块，要全部结束
 extern inline void end_request(int uptodate)
 {
+	struct buffer_head * bh;
+
 	DEVICE_OFF(CURRENT->dev);				//关闭设备
-	if (CURRENT->bh) {
-		CURRENT->bh->b_uptodate = uptodate;		//置更新标志为1
-		unlock_buffer(CURRENT->bh);				//解锁缓冲区
-	}
 	if (!uptodate) {
 		printk(DEVICE_NAME " I/O error\n\r");
 		printk("dev %04x, block %d\n\r",CURRENT->dev,
-			CURRENT->bh->b_blocknr);
+			CURRENT->sector>>1);
+	}
+	while (bh = CURRENT->bh) {
+		CURRENT->bh = bh->b_reqnext;
+		bh->b_reqnext = NULL;
+		bh->b_uptodate = uptodate;		//置更新标志
+		unlock_buffer(bh);				//解锁缓冲区
 	}
 	wake_up(&CURRENT->waiting);
 	wake_up(&wait_for_request);
@@ -132,6 +138,27 @@ extern inline void end_request(int uptodate)
 	CURRENT = CURRENT->next;
 }
 
+/*
+ * Requests for consecutive blocks are merged by make_request(), so a
+ * request can carry a chain of buffers linked through b_reqnext, all
+ * read or written as one transfer. When a driver has finished the first
+ * buffer, next_buffer() completes it and moves the request on to the
+ * next one. It returns 0 if there is no next buffer.
+ */
+extern inline int next_buffer(void)
+{
+	struct buffer_head * bh = CURRENT->bh;
+
+	if (!bh || !bh->b_reqnext)
+		return 0;
+	CURRENT->bh = bh->b_reqnext;
+	bh->b_reqnext = NULL;
+	bh->b_uptodate = 1;
+	unlock_buffer(bh);
+	CURRENT->buffer = CURRENT->bh->b_data;
+	return 1;
+}
+
 //定义初始化请求项宏
 #define INIT_REQUEST \
 repeat: \
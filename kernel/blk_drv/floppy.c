@@ -262,7 +262,13 @@ static void rw_interrupt(void)
 	if (command == FD_READ && (unsigned long)(CURRENT->buffer) >= 0x100000)
 		copy_buffer(tmp_floppy_area,CURRENT->buffer);
 	floppy_deselect(current_drive);
-	end_request(1);
+	//软盘每次只传送一块，请求项中还链有缓冲块时接着传送下一块
+	if (next_buffer()) {
+		CURRENT->sector += 2;
+		CURRENT->nr_sectors -= 2;
+		CURRENT->errors = 0;
+	} else
+		end_request(1);
 	do_fd_request();
 }
 
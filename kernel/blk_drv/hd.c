@@ -302,7 +302,10 @@ static void read_intr(void)
 	//若递减后不等于0，表示本项请求还有数据没读取完
 	//于是再次置中断调用C函数指针do_hd为read_intr()并直接返回，
 	//等待硬盘在独处另一个扇区数据后发出中断并再次调用本函数
+	//一个缓冲块(2个扇区)读完时转到请求项中链接的下一个缓冲块
 	if (--CURRENT->nr_sectors) {
+		if (!(CURRENT->nr_sectors & 1))
+			next_buffer();
 		do_hd = &read_intr;
 		return;
 	}
@@ -322,6 +325,8 @@ static void write_intr(void)
 	if (--CURRENT->nr_sectors) {
 		CURRENT->sector++;
 		CURRENT->buffer += 512;
+		if (!(CURRENT->nr_sectors & 1))
+			next_buffer();
 		do_hd = &write_intr;
 		port_write(HD_DATA,CURRENT->buffer,256);
 		return;
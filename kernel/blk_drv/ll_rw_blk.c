@@ -65,6 +65,33 @@ static inline void unlock_buffer(struct buffer_head * bh)
 	wake_up(&bh->b_wait);		//唤醒等待该缓冲区的任务
 }
 
+/*
+ * One bit per minor of every block device: set for devices that must
+ * not be written, like a ram disk holding a compressed image.
+ */
+static unsigned long ro_bits[NR_BLK_DEV][256/32];
+
+int is_read_only(int dev)
+{
+	int major = MAJOR(dev), minor = MINOR(dev);
+
+	if (major >= NR_BLK_DEV)
+		return 0;
+	return (ro_bits[major][minor>>5] >> (minor&31)) & 1;
+}
+
+void set_device_ro(int dev, int flag)
+{
+	int major = MAJOR(dev), minor = MINOR(dev);
+
+	if (major >= NR_BLK_DEV)
+		return;
+	if (flag)
+		ro_bits[major][minor>>5] |= 1UL << (minor&31);
+	else
+		ro_bits[major][minor>>5] &= ~(1UL << (minor&31));
+}
+
 /*
  * add-request adds a request to the linked list.
  * It disables interrupts so that it can muck with the
@@ -102,6 +129,38 @@ static void add_request(struct blk_dev_struct * dev, struct request * req)
 	sti();
 }
 
+/*
+ * Try to add bh to the end of a queued request for the block just
+ * before it, so that consecutive blocks (the blocks of a zone, or a
+ * sync of a file written in order) go to the disk as one multi-sector
+ * transfer. The request at the head may already be in the hands of the
+ * driver and is never touched.
+ */
+#define MAX_MERGE_SECTORS 64
+
+static int merge_request(struct blk_dev_struct * dev, int rw,
+	struct buffer_head * bh)
+{
+	struct request * req;
+
+	cli();
+	if (req = dev->current_request)
+		for (req = req->next ; req ; req = req->next)
+			if (req->dev == bh->b_dev && req->cmd == rw && req->bh &&
+			    req->sector + req->nr_sectors == bh->b_blocknr<<1 &&
+			    req->nr_sectors < MAX_MERGE_SECTORS) {
+				bh->b_dirt = 0;
+				bh->b_reqnext = NULL;
+				req->bhtail->b_reqnext = bh;
+				req->bhtail = bh;
+				req->nr_sectors += 2;
+				sti();
+				return 1;
+			}
+	sti();
+	return 0;
+}
+
 //创建请求项并插入请求队列
 static void make_request(int major,int rw, struct buffer_head * bh)
 {
@@ -130,6 +189,9 @@ static void make_request(int major,int rw, struct buffer_head * bh)
 		unlock_buffer(bh);
 		return;
 	}
+	//能并入队列中已有的请求项时就不必再占用一个请求项
+	if (merge_request(major+blk_dev,rw,bh))
+		return;
 repeat:
 /* we don't allow the write-requests to fill up the queue completely:
  * we want some room for reads: they take precedence. The last third
@@ -165,6 +227,8 @@ repeat:
 	req->buffer = bh->b_data;			//请求项缓冲区指针指向需读写的数据缓冲区
 	req->waiting = NULL;					//任务等待操作执行完成的地方
 	req->bh = bh;							//缓冲块头指针
+	req->bhtail = bh;
+	bh->b_reqnext = NULL;
 	req->next = NULL;					//指向下一请求队列
 	//将请求项加入队列中
 	add_request(major+blk_dev,req);		
@@ -177,6 +241,16 @@ void ll_rw_block(int rw, struct buffer_head * bh)
 {
 	unsigned int major;
 
+	//只读设备上的块不写，清除脏标志以免sync时反复出错
+	if ((rw == WRITE || rw == WRITEA) && is_read_only(bh->b_dev)) {
+		printk("Can't write to read-only device %04x\n\r",bh->b_dev);
+		bh->b_dirt = 0;
+		return;
+	}
+	//钉在日志事务中的块要等事务提交后才能写回原处
+	if ((rw == WRITE || rw == WRITEA) && bh->b_jtrans)
+		return;
+
 	//如果主设备号不存在或者该设备号的请求操作函数不存在，则显示出错信息并返回
 	if ((major=MAJOR(bh->b_dev)) >= NR_BLK_DEV ||
 	!(blk_dev[major].request_fn)) {
@@ -20,28 +20,123 @@
 char	*rd_start;
 int	rd_length = 0;			//虚拟盘所占内存大小(字节)
 
+/*
+ * A compressed root image holds a minix file system cut into 1k blocks,
+ * each compressed on its own (tools/rdzip). It starts with rd_zheader,
+ * followed by z_nblocks+1 offsets from the start of the image: block n
+ * is stored from offset[n] to offset[n+1]. A block that did not get
+ * smaller is stored as it is, in exactly BLOCK_SIZE bytes.
+ *
+ * Such an image stays compressed in the ram disk. Blocks are only
+ * decompressed when the buffer cache reads them, so the file system can
+ * be bigger than the ram disk. The ram disk is read-only then.
+ */
+#define RD_ZMAGIC 0x7a64		//"dz"
+
+struct rd_zheader {
+	unsigned long z_magic;
+	unsigned long z_nblocks;	//解压后的盘块数
+	unsigned long z_length;		//整个压缩映像的字节数
+};
+
+static struct rd_zheader * rd_zimage = NULL;	//虚拟盘中是压缩映像时指向其头部
+
+/*
+ * lzss: a flag byte says for each of the next 8 items whether it is a
+ * literal byte (bit set) or a match: two bytes holding a 12-bit distance
+ * back into the output and the length-3 in the low 4 bits.
+ * Returns the number of bytes produced, -1 if the data is corrupt.
+ */
+static int lzss_decompress(unsigned char * src, int len,
+	unsigned char * dst, int size)
+{
+	unsigned char * end = src+len;
+	unsigned int flags = 0;
+	int n = 0, dist, count;
+
+	while (src < end && n < size) {
+		if (!((flags >>= 1) & 0x100)) {
+			flags = *src++ | 0xff00;
+			if (src >= end)
+				break;
+		}
+		if (flags & 1) {
+			dst[n++] = *src++;
+			continue;
+		}
+		if (src+2 > end)
+			return -1;
+		dist = src[0] | ((src[1] & 0xf0) << 4);
+		count = (src[1] & 0x0f) + 3;
+		src += 2;
+		if (!dist || dist > n)
+			return -1;
+		while (count-- && n < size) {
+			dst[n] = dst[n-dist];
+			n++;
+		}
+	}
+	return n;
+}
+
+//把当前请求项要读的各块从压缩映像中解压到缓冲块，成功返回1
+static int rd_unzip(void)
+{
+	unsigned long * offset = (unsigned long *) (rd_zimage+1);
+	unsigned long block = CURRENT->sector >> 1;
+	int len;
+
+	if (MINOR(CURRENT->dev) != 1 || CURRENT->cmd != READ)
+		return 0;
+	do {
+		if (block >= rd_zimage->z_nblocks)
+			return 0;
+		len = offset[block+1] - offset[block];
+		if (offset[block+1] > rd_zimage->z_length ||
+		    len <= 0 || len > BLOCK_SIZE)
+			return 0;
+		if (len == BLOCK_SIZE)
+			memcpy(CURRENT->buffer,rd_start+offset[block],BLOCK_SIZE);
+		else if (lzss_decompress((unsigned char *) rd_start+offset[block],
+		    len,(unsigned char *) CURRENT->buffer,BLOCK_SIZE) != BLOCK_SIZE)
+			return 0;
+		block++;
+	} while (next_buffer());
+	return 1;
+}
+
 void do_rd_request(void)
 {
 	int	len;
 	char	*addr;
 
 	INIT_REQUEST;
+	if (rd_zimage) {
+		end_request(rd_unzip());
+		goto repeat;
+	}
 	addr = rd_start + (CURRENT->sector << 9);
 	len = CURRENT->nr_sectors << 9;
 	if ((MINOR(CURRENT->dev) != 1) || (addr+len > rd_start+rd_length)) {
 		end_request(0);
 		goto repeat;
 	}
-	if (CURRENT-> cmd == WRITE) {
-		(void ) memcpy(addr,
-			      CURRENT->buffer,
-			      len);
-	} else if (CURRENT->cmd == READ) {
-		(void) memcpy(CURRENT->buffer, 
-			      addr,
-			      len);
-	} else
-		panic("unknown ramdisk-command");
+	//合并过的请求项中各缓冲块的数据区不相连，要逐块复制
+	do {
+		if (CURRENT->bh)
+			len = BLOCK_SIZE;
+		if (CURRENT-> cmd == WRITE) {
+			(void ) memcpy(addr,
+				      CURRENT->buffer,
+				      len);
+		} else if (CURRENT->cmd == READ) {
+			(void) memcpy(CURRENT->buffer, 
+				      addr,
+				      len);
+		} else
+			panic("unknown ramdisk-command");
+		addr += len;
+	} while (next_buffer());
 	end_request(1);
 	goto repeat;
 }
@@ -77,6 +172,7 @@ void rd_load(void)
 {
 	struct buffer_head *bh;			//高速缓冲块头指针
 	struct super_block	s;		//文件超级块结构
+	struct rd_zheader	z;		//压缩映像头
 	int		block = 256;	/* Start at block 256 */ //根文件系统映像文件被存储在boot盘第256磁盘块开始处
 	int		i = 1;
 	int		nblocks;		//文件系统盘块总数
@@ -100,13 +196,25 @@ void rd_load(void)
 	//把缓冲区中的磁盘超级块(d_super_block是磁盘超级块结构)复制到s变量，并释放缓冲区
 	*((struct d_super_block *) &s) = *((struct d_super_block *) bh->b_data);
 	brelse(bh);
-	//如果不等，说明不是minix文件系统
-	if (s.s_magic != SUPER_MAGIC)
+	//第256块已由上面的breada()读入，看它是不是压缩映像头
+	if (!(bh = bread(ROOT_DEV,block))) {
+		printk("Disk error while looking for ramdisk!\n");
+		return;
+	}
+	z = *((struct rd_zheader *) bh->b_data);
+	brelse(bh);
+	//压缩映像按压缩后的长度加载，否则按文件系统的大小加载
+	if (z.z_magic == RD_ZMAGIC)
+		nblocks = (z.z_length + BLOCK_SIZE-1) >> BLOCK_SIZE_BITS;
+	else if (s.s_magic == SUPER_MAGIC)
+		nblocks = s.s_nzones << s.s_log_zone_size;
+	else if (s.s_magic == SUPER_MAGIC_V2)
+		nblocks = s.s_zones << s.s_log_zone_size;
+	else
 		/* No ram disk image present, assume normal floppy boot */
 		//磁盘中没有ramdisk映像文件，退出去执行通常的软盘引导
 		return;
 	//文件系统中数据块总数大于内存虚拟盘所能容纳的开始，则不能执行加载操作，显示储蓄哦信息并返回
-	nblocks = s.s_nzones << s.s_log_zone_size;
 	if (nblocks > (rd_length >> BLOCK_SIZE_BITS)) {
 		printk("Ram disk image too big!  (%d blocks, %d avail)\n", 
 			nblocks, rd_length >> BLOCK_SIZE_BITS);
@@ -138,6 +246,19 @@ void rd_load(void)
 	}
 	//当boot盘中从256盘块开始的整个根文件系统加载完毕后，显示"done"
 	printk("\010\010\010\010\010done \n");
+	//压缩映像的偏移表必须在映像之内，并正好到映像末尾
+	if (z.z_magic == RD_ZMAGIC) {
+		if (sizeof(z) + (z.z_nblocks+1)*sizeof(long) > z.z_length ||
+		    ((unsigned long *) (rd_start+sizeof(z)))[z.z_nblocks] !=
+		    z.z_length) {
+			printk("Bad compressed ram disk image\n");
+			return;
+		}
+		rd_zimage = (struct rd_zheader *) rd_start;
+		set_device_ro(0x0101,1);
+		printk("Ram disk is compressed: %d blocks, read-only\n",
+			z.z_nblocks);
+	}
 	//把目前根文件设备号修改成虚拟盘的设备号0x0101
 	ROOT_DEV=0x0101;
 }
@@ -13,6 +13,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <signal.h>
+#include <fcntl.h>
 
 #define ALRMMASK (1<<(SIGALRM-1))
 #define KILLMASK (1<<(SIGKILL-1))
@@ -233,11 +234,12 @@ void copy_to_cooked(struct tty_struct * tty)
 	wake_up(&tty->secondary.proc_list);
 }
 
-int tty_read(unsigned channel, char * buf, int nr)
+int tty_read(unsigned channel, char * buf, int nr, unsigned short flags)
 {
 	struct tty_struct * tty;
 	char c, * b=buf;
-	int minimum,time,flag=0;
+	char tmp[64];
+	int minimum,time,flag=0,n;
 	long oldalarm;
 
 	if (channel>2 || nr<0) return -1;
@@ -261,21 +263,34 @@ int tty_read(unsigned channel, char * buf, int nr)
 			break;
 		if (EMPTY(tty->secondary) || (L_CANON(tty) &&
 		!tty->secondary.data && LEFT(tty->secondary)>20)) {
+			//非阻塞方式打开的终端不等待输入
+			if (flags & O_NONBLOCK)
+				break;
 			sleep_if_empty(&tty->secondary);
 			continue;
 		}
+		//字符先收集到tmp[]中，再成块复制到用户缓冲区
+		n = 0;
 		do {
 			GETCH(tty->secondary,c);
 			if (c==EOF_CHAR(tty) || c==10)
 				tty->secondary.data--;
-			if (c==EOF_CHAR(tty) && L_CANON(tty))
-				return (b-buf);
-			else {
-				put_fs_byte(c,b++);
+			if (c==EOF_CHAR(tty) && L_CANON(tty)) {
+				memcpy_tofs(b,tmp,n);
+				return (b+n-buf);
+			} else {
+				tmp[n++] = c;
 				if (!--nr)
 					break;
+				if (n == sizeof(tmp)) {
+					memcpy_tofs(b,tmp,n);
+					b += n;
+					n = 0;
+				}
 			}
 		} while (nr>0 && !EMPTY(tty->secondary));
+		memcpy_tofs(b,tmp,n);
+		b += n;
 		if (time && !L_CANON(tty))
 			if (flag=(!oldalarm || time+jiffies<oldalarm))
 				current->alarm = time+jiffies;
@@ -290,10 +305,12 @@ int tty_read(unsigned channel, char * buf, int nr)
 	current->alarm = oldalarm;
 	if (current->signal && !(b-buf))
 		return -EINTR;
+	if ((flags & O_NONBLOCK) && !(b-buf))
+		return -EAGAIN;
 	return (b-buf);
 }
 
-int tty_write(unsigned channel, char * buf, int nr)
+int tty_write(unsigned channel, char * buf, int nr, unsigned short flags)
 {
 	static cr_flag=0;
 	struct tty_struct * tty;
@@ -302,7 +319,10 @@ int tty_write(unsigned channel, char * buf, int nr)
 	if (channel>2 || nr<0) return -1;
 	tty = channel + tty_table;
 	while (nr>0) {
-		sleep_if_full(&tty->write_q);
+		if (!(flags & O_NONBLOCK))
+			sleep_if_full(&tty->write_q);
+		else if (FULL(tty->write_q))
+			break;
 		if (current->signal)
 			break;
 		while (nr>0 && !FULL(tty->write_q)) {
@@ -325,9 +345,11 @@ int tty_write(unsigned channel, char * buf, int nr)
 			PUTCH(c,tty->write_q);
 		}
 		tty->write(tty);
-		if (nr>0)
+		if (nr>0 && !(flags & O_NONBLOCK))
 			schedule();
 	}
+	if ((flags & O_NONBLOCK) && nr && !(b-buf))
+		return -EAGAIN;
 	return (b-buf);
 }
 
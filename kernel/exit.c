@@ -115,7 +115,8 @@ int do_exit(long code)
 {
 	int i;
 
-	//释放当前进程代码段和数据段所占的页表
+	//先解除文件映射(共享映射中被写过的页面要写回文件)，再释放当前进程代码段和数据段所占的页表
+	exit_mmap();
 	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
 	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
 	//如果当前进程有子进程，就将子进程的father置为1(其父进程改为进程1，即init进程)
@@ -128,9 +129,10 @@ int do_exit(long code)
 				(void) send_sig(SIGCHLD, task[1], 1);
 		}
 	//关闭当前进程打开着的所有文件
-	for (i=0 ; i<NR_OPEN ; i++)
+	for (i=0 ; i<current->max_fds ; i++)
 		if (current->filp[i])
 			sys_close(i);
+	exit_files();
 	//对当前进程的工作目录pwd、根目录root以及执行程序文件的i节点进行同步操作
 	//放回各个i节点并分别置空(释放)
 	iput(current->pwd);
@@ -107,6 +107,7 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	p->counter = p->priority;
 	p->signal = 0;
 	p->alarm = 0;
+	p->timeout = 0;
 	p->leader = 0;		/* process leadership doesn't inherit */
 	p->utime = p->stime = 0;
 	p->cutime = p->cstime = 0;
@@ -142,17 +143,25 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	//协处理器相关
 	if (last_task_used_math == current)
 		__asm__("clts ; fnsave %0"::"m" (p->tss.i387));
+	//子进程要有自己的文件句柄表，不能与父进程共用
+	if (copy_files(p)) {
+		task[nr] = NULL;
+		free_page((long) p);
+		return -EAGAIN;
+	}
 	//复制进程页表
 	//在线性地址空间中设置新任务代码段和数据段描述符中的基址和限长，并复制页表
 	if (copy_mem(nr,p)) {
 		//如果出错(返回值不是0)，
 		//则复位任务数组中相应项并释放为该新任务分配的用于任务结构的内存页
 		task[nr] = NULL;
+		if (p->filp != p->init_filp)
+			free_page((long) p->filp);
 		free_page((long) p);
 		return -EAGAIN;
 	}
 	//如果父进程中有文件是打开的，则将对应文件的打开次数增1
-	for (i=0; i<NR_OPEN;i++)
+	for (i=0; i<p->max_fds;i++)
 		if (f=p->filp[i])
 			f->f_count++;
 	//将当前进程(父进程)的pwd、root和executable引用次数均增1
@@ -162,6 +171,10 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 		current->root->i_count++;
 	if (current->executable)
 		current->executable->i_count++;
+	//子进程继承父进程的文件映射区，映射的i节点引用次数也要增1
+	for (i=0; i<NR_MMAP; i++)
+		if (p->mmap[i].m_inode)
+			p->mmap[i].m_inode->i_count++;
 	//在GDT表中设置新任务TSS段和LDT段描述符项
 	set_tss_desc(gdt+(nr<<1)+FIRST_TSS_ENTRY,&(p->tss));
 	set_ldt_desc(gdt+(nr<<1)+FIRST_LDT_ENTRY,&(p->ldt));
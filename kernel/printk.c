@@ -29,12 +29,14 @@ int printk(const char *fmt, ...)
 	__asm__("push %%fs\n\t"
 		"push %%ds\n\t"
 		"pop %%fs\n\t"
+		"pushl $0\n\t"
 		"pushl %0\n\t"
 		"pushl $_buf\n\t"
 		"pushl $0\n\t"
 		"call _tty_write\n\t"
 		"addl $8,%%esp\n\t"
 		"popl %0\n\t"
+		"addl $4,%%esp\n\t"
 		"pop %%fs"
 		::"r" (i):"ax","cx","dx");
 	return i;
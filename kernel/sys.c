@@ -168,7 +168,8 @@ int sys_times(struct tms * tbuf)
 int sys_brk(unsigned long end_data_seg)
 {
 	if (end_data_seg >= current->end_code &&
-	    end_data_seg < current->start_stack - 16384)
+	    end_data_seg < current->start_stack - 16384 &&
+	    end_data_seg <= MMAP_START)
 		current->brk = end_data_seg;
 	return current->brk;
 }
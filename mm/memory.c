@@ -21,6 +21,8 @@
  */
 
 #include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
 
 #include <asm/system.h>
 
@@ -29,6 +31,8 @@
 #include <linux/kernel.h>
 
 volatile void do_exit(long code);
+void do_no_page(unsigned long error_code,unsigned long address);
+static int shrink_page_cache(int n);
 
 //显示"内存已用完"出错信息，并退出
 //函数名前的关键字volatile用于告诉编译器gcc该函数不会返回，这样可让gcc产生更好的代码
@@ -78,7 +82,7 @@ static unsigned char mem_map [ PAGING_PAGES ] = {0,};
 //首先扫描内存页面字节图数组mem_map[]，寻找值是0的字节项(对应空闲页面)
 //若无则返回0结束，表示物理内存已使用完。若找到值为0的字节，则将其置1，并换算出对应空闲页面的起始地址
 //然后对该内存页面作清零操作，最后返回该空闲页面的物理内存起始地址
-unsigned long get_free_page(void)
+static unsigned long find_free_page(void)
 {
 register unsigned long __res asm("ax");
 
@@ -102,6 +106,16 @@ __asm__("std ; repne ; scasb\n\t"	//置方向位，al(0)与对应每个页面的
 return __res;								//返回空闲物理页面地址(若无空闲页面则返回0)
 }
 
+//没有空闲页时，先把只有页面缓存还在用的页放回来再找一次
+unsigned long get_free_page(void)
+{
+	unsigned long page;
+
+	if (!(page = find_free_page()) && shrink_page_cache(16))
+		page = find_free_page();
+	return page;
+}
+
 //free_page()用于释放指定地址处的一页物理内存
 void free_page(unsigned long addr)
 {
@@ -321,28 +335,49 @@ void un_wp_page(unsigned long * table_entry)
  */
 void do_wp_page(unsigned long error_code,unsigned long address)
 {
+	struct mmap_struct * m;
+	unsigned long * table_entry;
+
 #if 0
 /* we cannot do this yet: the estdio library writes to code space */
 /* stupid, stupid. I really want the libc.a from GNU */
 	if (CODE_SPACE(address))
 		do_exit(SIGSEGV);
 #endif
-	un_wp_page((unsigned long *)
+	table_entry = (unsigned long *)
 		(((address>>10) & 0xffc) + (0xfffff000 &
-		*((unsigned long *) ((address>>20) &0xffc)))));
-
+		*((unsigned long *) ((address>>20) &0xffc))));
+	//写文件映射区：只读映射是段错误；可写的共享映射(fork之后页面被写保护)
+	//所有进程应该看到同一页，因此直接恢复写权限而不复制
+	if (m = find_mmap(address - current->start_code)) {
+		if (!(m->m_prot & PROT_WRITE))
+			do_exit(SIGSEGV);
+		if (m->m_flags & MAP_SHARED) {
+			*table_entry |= 2;
+			invalidate();
+			return;
+		}
+	}
+	un_wp_page(table_entry);
 }
 
 void write_verify(unsigned long address)
 {
 	unsigned long page;
+	struct mmap_struct * m;
 
 	if (!( (page = *((unsigned long *) ((address>>20) & 0xffc)) )&1))
 		return;
 	page &= 0xfffff000;
 	page += ((address>>10) & 0xffc);
-	if ((3 & *(unsigned long *) page) == 1)  /* non-writeable, present */
-		un_wp_page((unsigned long *) page);
+	if ((3 & *(unsigned long *) page) == 1) {  /* non-writeable, present */
+		m = find_mmap(address - current->start_code);
+		if (m && (m->m_flags & MAP_SHARED) && (m->m_prot & PROT_WRITE)) {
+			*(unsigned long *) page |= 2;
+			invalidate();
+		} else
+			un_wp_page((unsigned long *) page);
+	}
 	return;
 }
 
@@ -438,21 +473,468 @@ static int share_page(unsigned long address)
 	return 0;
 }
 
+/*
+ * Page-table entry of a linear address, or NULL if there is no page
+ * table for it.
+ */
+static unsigned long * get_pte(unsigned long address)
+{
+	unsigned long * dir;
+
+	dir = (unsigned long *) ((address>>20) & 0xffc);
+	if (!(1 & *dir))
+		return NULL;
+	return (unsigned long *) ((0xfffff000 & *dir) + ((address>>10) & 0xffc));
+}
+
+/*
+ * get_user_page() and put_user_page() let pipes move whole pages instead
+ * of copying them. get_user_page() takes an extra reference to the page
+ * at a user linear address and write-protects it, so the owner's next
+ * write copies it (COW). put_user_page() installs "page" read-only at
+ * "address" in place of a private page, and returns that old page to the
+ * caller. Both refuse pages of file mappings and return 0.
+ */
+unsigned long get_user_page(unsigned long address)
+{
+	unsigned long * pte;
+	unsigned long page;
+
+	if (find_mmap(address - current->start_code))
+		return 0;
+	if (!(pte = get_pte(address)) || !(1 & *pte))
+		return 0;
+	page = 0xfffff000 & *pte;
+	if (page < LOW_MEM || page >= HIGH_MEMORY)
+		return 0;
+	*pte &= ~2;
+	invalidate();
+	mem_map[MAP_NR(page)]++;
+	return page;
+}
+
+unsigned long put_user_page(unsigned long page,unsigned long address)
+{
+	unsigned long * pte;
+	unsigned long old_page;
+
+	if (find_mmap(address - current->start_code))
+		return 0;
+	if (!(pte = get_pte(address)) || !(1 & *pte))
+		return 0;
+	old_page = 0xfffff000 & *pte;
+	if (old_page < LOW_MEM || old_page >= HIGH_MEMORY)
+		return 0;
+	if (mem_map[MAP_NR(old_page)] != 1)
+		return 0;
+	*pte = page | 5;
+	invalidate();
+	return old_page;
+}
+
+//页面是否还被别处引用
+int page_shared(unsigned long page)
+{
+	return page >= LOW_MEM && mem_map[MAP_NR(page)] > 1;
+}
+
+/*
+ * pin_user_page() makes the page at the user address addr present (and
+ * private and writable if "write" is set, as the CPU doesn't honour
+ * write protection in kernel mode), then takes an extra reference to it
+ * so that it stays put while a driver transfers data to or from it.
+ * Returns the physical page, to be given back with free_page(), or 0.
+ */
+unsigned long pin_user_page(unsigned long addr, int write)
+{
+	unsigned long * pte;
+	unsigned long address,page;
+
+	if (addr >= get_limit(0x17))
+		return 0;
+	address = addr + current->start_code;
+	if (!(pte = get_pte(address)) || !(1 & *pte)) {
+		do_no_page(write ? 2 : 0,address);
+		if (!(pte = get_pte(address)) || !(1 & *pte))
+			return 0;
+	}
+	if (write)
+		write_verify(address);
+	page = 0xfffff000 & *pte;
+	if (page < LOW_MEM || page >= HIGH_MEMORY)
+		return 0;
+	mem_map[MAP_NR(page)]++;
+	return page;
+}
+
+/*
+ * The page cache keeps pages of executables, keyed by the inode and the
+ * offset in the file, after the last task using them has exited, so
+ * running the same program again maps them without reading or copying
+ * anything. A cached page holds one count in mem_map[] and is mapped
+ * read-only wherever it is used: a write copies it (un_wp_page()), and
+ * the cached copy stays clean. Pages only the cache still holds are
+ * given back when get_free_page() runs out. Writing or truncating the
+ * file throws its pages away (invalidate_pages()).
+ */
+#define PC_HASH 64
+#define FAULT_AROUND 8		//缺页时一并映射缓存页的窗口(页数，2的幂)
+#define READ_AHEAD 4		//缺页读盘后为其后的页发出预读的页数
+#define pc_hashfn(dev,ino,off) (((unsigned)((dev)^(ino)^((off)>>12)))%PC_HASH)
+#define pc_inofn(dev,ino) (((unsigned)((dev)^(ino)))%PC_HASH)
+
+static struct cached_page {
+	unsigned short c_dev;
+	unsigned short c_ino;
+	unsigned long c_off;				//文件内偏移
+	unsigned long c_page;				//物理页面，0表示空闲项
+	struct cached_page * c_next;		//hash队列
+} page_cache[NR_CACHED_PAGES];
+
+static struct cached_page * pc_hash[PC_HASH];
+static unsigned short pc_inodes[PC_HASH];	//按(dev,ino)散列的缓存页数，为0的文件不必查
+static int nr_cached = 0;
+static int pc_hand = 0;					//回收时轮转扫描的位置
+
+static struct cached_page * find_cached(int dev, int ino, unsigned long off)
+{
+	struct cached_page * p;
+
+	for (p = pc_hash[pc_hashfn(dev,ino,off)] ; p ; p = p->c_next)
+		if (p->c_dev == dev && p->c_ino == ino && p->c_off == off)
+			return p;
+	return NULL;
+}
+
+//把一项移出缓存，并放掉缓存对页面的引用
+static void uncache(struct cached_page * p)
+{
+	struct cached_page ** pp;
+
+	pp = &pc_hash[pc_hashfn(p->c_dev,p->c_ino,p->c_off)];
+	while (*pp != p)
+		pp = &(*pp)->c_next;
+	*pp = p->c_next;
+	pc_inodes[pc_inofn(p->c_dev,p->c_ino)]--;
+	nr_cached--;
+	free_page(p->c_page);
+	p->c_page = 0;
+}
+
+//放掉最多n个没有进程在用的缓存页，返回放掉的页数
+static int shrink_page_cache(int n)
+{
+	struct cached_page * p;
+	int i, freed = 0;
+
+	for (i=0 ; i<NR_CACHED_PAGES && freed<n && nr_cached ; i++) {
+		p = page_cache + pc_hand;
+		pc_hand = (pc_hand+1) % NR_CACHED_PAGES;
+		if (p->c_page && mem_map[MAP_NR(p->c_page)] == 1) {
+			uncache(p);
+			freed++;
+		}
+	}
+	return freed;
+}
+
+/*
+ * Drop the cached pages of inode ino on dev, or of the whole device if
+ * ino is 0. Tasks that have them mapped keep their copy.
+ */
+void invalidate_pages(int dev, int ino)
+{
+	struct cached_page * p;
+
+	if (!nr_cached || (ino && !pc_inodes[pc_inofn(dev,ino)]))
+		return;
+	for (p = page_cache ; p < page_cache+NR_CACHED_PAGES ; p++)
+		if (p->c_page && p->c_dev == dev && (!ino || p->c_ino == ino))
+			uncache(p);
+}
+
+//把刚映射到address处的页面page加入缓存，并把映射改为只读
+static void cache_page(struct m_inode * inode, unsigned long off,
+	unsigned long page, unsigned long address)
+{
+	struct cached_page * p;
+
+	if (nr_cached >= NR_CACHED_PAGES && !shrink_page_cache(1))
+		return;
+	for (p = page_cache ; p->c_page ; p++)
+		/* nothing */ ;
+	p->c_dev = inode->i_dev;
+	p->c_ino = inode->i_num;
+	p->c_off = off;
+	p->c_page = page;
+	p->c_next = pc_hash[pc_hashfn(p->c_dev,p->c_ino,off)];
+	pc_hash[pc_hashfn(p->c_dev,p->c_ino,off)] = p;
+	pc_inodes[pc_inofn(p->c_dev,p->c_ino)]++;
+	nr_cached++;
+	mem_map[MAP_NR(page)]++;
+	*get_pte(address) &= ~2;
+}
+
+//缓存中有文件的这一页就只读地映射到address处
+static int map_cached_page(struct m_inode * inode, unsigned long off,
+	unsigned long address)
+{
+	struct cached_page * p;
+	unsigned long * pte, tmp;
+
+	if (!nr_cached || !pc_inodes[pc_inofn(inode->i_dev,inode->i_num)])
+		return 0;
+	//先准备好页表：get_free_page()可能回收缓存页
+	if (!(pte = get_pte(address))) {
+		if (!(tmp = get_free_page()))
+			oom();
+		*(unsigned long *) ((address>>20) & 0xffc) = tmp | 7;
+		pte = get_pte(address);
+	}
+	if (!(p = find_cached(inode->i_dev,inode->i_num,off)))
+		return 0;
+	*pte = p->c_page | 5;
+	mem_map[MAP_NR(p->c_page)]++;
+	return 1;
+}
+
+/*
+ * Map the cached pages around the one at tmp that just faulted in, in
+ * the FAULT_AROUND-page window that holds it: a program that has run
+ * before then takes one fault per window instead of one per page. The
+ * window is aligned, so it never crosses a page table, and the one for
+ * the faulting page already exists.
+ */
+static void fault_around(struct m_inode * inode, unsigned long tmp)
+{
+	struct cached_page * p;
+	unsigned long * pte;
+	int i;
+
+	if (!nr_cached || !pc_inodes[pc_inofn(inode->i_dev,inode->i_num)])
+		return;
+	tmp &= ~(FAULT_AROUND*4096-1);
+	for (i=0 ; i<FAULT_AROUND && tmp<current->end_data ; i++,tmp += 4096) {
+		if (!(pte = get_pte(current->start_code+tmp)) || *pte)
+			continue;
+		if (p = find_cached(inode->i_dev,inode->i_num,BLOCK_SIZE+tmp)) {
+			*pte = p->c_page | 5;
+			mem_map[MAP_NR(p->c_page)]++;
+		}
+	}
+}
+
+//为tmp之后还不在缓存中的至多READ_AHEAD页发出预读，下次缺页时就不必等磁盘
+static void read_ahead(struct m_inode * inode, unsigned long tmp)
+{
+	unsigned long next = tmp + 4096;
+	int i;
+
+	if (!inode->i_op->readahead)
+		return;
+	for (i=0 ; i<READ_AHEAD ; i++) {
+		tmp += 4096;
+		if (tmp >= current->end_data ||
+		    find_cached(inode->i_dev,inode->i_num,BLOCK_SIZE+tmp))
+			break;
+	}
+	if (i)
+		inode->i_op->readahead(inode,BLOCK_SIZE+next,i);
+}
+
+/*
+ * Called by do_execve() once the new program is set up: fault in the
+ * first EXEC_PREFAULT pages of its text now, instead of one fault at a
+ * time after it has started.
+ */
+void prefault_text(void)
+{
+	unsigned long tmp, * pte;
+
+	for (tmp = 0 ; tmp < EXEC_PREFAULT*4096 && tmp < current->end_code ;
+	     tmp += 4096)
+		if (!(pte = get_pte(current->start_code+tmp)) || !*pte)
+			do_no_page(0,current->start_code+tmp);
+}
+
+/*
+ * share_mmap_page() looks for another task that has the file page at
+ * "off" present in a MAP_SHARED mapping of the same inode, and maps that
+ * physical page at "address" too. A private mapping gets it write-
+ * protected, so its first write copies it like any other COW page.
+ */
+static int share_mmap_page(struct mmap_struct * m, unsigned long off,
+	unsigned long address)
+{
+	struct task_struct ** p;
+	struct mmap_struct * q;
+	unsigned long * from, * to;
+	unsigned long phys_addr, tmp;
+
+	if (m->m_inode->i_count < 2)
+		return 0;
+	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p) {
+		if (!*p || *p == current)
+			continue;
+		for (q = (*p)->mmap ; q < (*p)->mmap + NR_MMAP ; q++) {
+			if (q->m_inode != m->m_inode || !(q->m_flags & MAP_SHARED))
+				continue;
+			if (off < q->m_offset || off - q->m_offset >= q->m_end - q->m_start)
+				continue;
+			from = get_pte((*p)->start_code + q->m_start + off - q->m_offset);
+			if (!from || !(1 & *from))
+				continue;
+			phys_addr = *from & 0xfffff000;
+			if (phys_addr >= HIGH_MEMORY || phys_addr < LOW_MEM)
+				continue;
+			if (!(to = get_pte(address))) {
+				if (!(tmp = get_free_page()))
+					oom();
+				*(unsigned long *) ((address>>20) & 0xffc) = tmp | 7;
+				to = get_pte(address);
+			}
+			*to = phys_addr | 7;
+			if (!(m->m_flags & MAP_SHARED) || !(m->m_prot & PROT_WRITE))
+				*to &= ~2;
+			mem_map[MAP_NR(phys_addr)]++;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * mmap_no_page() fills a page of a file mapping: from another task's
+ * shared mapping if there is one, else with the readpage operation of
+ * the file, the same way do_no_page() loads executables.
+ */
+static void mmap_no_page(struct mmap_struct * m, unsigned long tmp,
+	unsigned long address)
+{
+	struct m_inode * inode = m->m_inode;
+	unsigned long off, page;
+	int i;
+
+	off = tmp - m->m_start + m->m_offset;
+	if ((m->m_flags & MAP_SHARED) && share_mmap_page(m,off,address))
+		return;
+	if (!(page = get_free_page()))
+		oom();
+	inode->i_op->readpage(inode,off,page);
+	//读盘时可能有别的进程已经把同一页映射进来了，共享映射必须用同一页
+	if ((m->m_flags & MAP_SHARED) && share_mmap_page(m,off,address)) {
+		free_page(page);
+		return;
+	}
+	//文件末尾之后的部分清零
+	i = off + 4096 - inode->i_size;
+	if (i > 4096)
+		i = 4096;
+	tmp = page + 4096;
+	while (i-- > 0) {
+		tmp--;
+		*(char *)tmp = 0;
+	}
+	if (!put_page(page,address)) {
+		free_page(page);
+		oom();
+	}
+	if (!(m->m_prot & PROT_WRITE))
+		*get_pte(address) &= ~2;
+}
+
+//把共享映射中被写过的一页写回文件
+static void write_mmap_page(struct m_inode * inode, unsigned long off,
+	unsigned long page)
+{
+	invalidate_pages(inode->i_dev,inode->i_num);
+	journal_start(inode->i_dev);
+	inode->i_op->writepage(inode,off,page);
+	journal_stop(inode->i_dev);
+	inode->i_mtime = CURRENT_TIME;
+	inode->i_dirt = 1;
+}
+
+/*
+ * unmap_pages() drops the pages of the current task between the logical
+ * addresses "from" and "to" inside mapping m, writing back the dirty
+ * ones of a shared mapping first.
+ */
+void unmap_pages(struct mmap_struct * m,unsigned long from,unsigned long to)
+{
+	unsigned long * pte;
+	unsigned long page;
+
+	for ( ; from < to ; from += 4096) {
+		if (!(pte = get_pte(current->start_code + from)) || !(1 & *pte))
+			continue;
+		page = 0xfffff000 & *pte;
+		if ((m->m_flags & MAP_SHARED) && (*pte & 0x40))
+			write_mmap_page(m->m_inode,from - m->m_start + m->m_offset,page);
+		*pte = 0;
+		free_page(page);
+	}
+	invalidate();
+}
+
+/*
+ * sync_mmap() writes back the dirty pages of the shared mappings of
+ * inode in every task (of all shared mappings if inode is NULL), for
+ * sync() and fsync(). They are left mapped, only clean. The page and
+ * the inode are held while a page is written: the task may unmap it
+ * meanwhile.
+ */
+void sync_mmap(struct m_inode * inode)
+{
+	struct task_struct ** p;
+	struct mmap_struct * m;
+	struct m_inode * mi;
+	unsigned long from,page,* pte;
+
+	for (p = &FIRST_TASK ; p <= &LAST_TASK ; p++) {
+		if (!*p)
+			continue;
+		for (m = (*p)->mmap ; m < (*p)->mmap + NR_MMAP ; m++)
+			for (from = m->m_start ; from < m->m_end ; from += 4096) {
+				if (!(mi = m->m_inode) || (inode && mi != inode) ||
+				    !(m->m_flags & MAP_SHARED))
+					break;
+				if (!(pte = get_pte((*p)->start_code + from)) ||
+				    (*pte & 0x41) != 0x41)
+					continue;
+				//先清除已修改标志，写回期间再写这一页会重新置位
+				page = 0xfffff000 & *pte;
+				*pte &= ~0x40;
+				invalidate();
+				mem_map[MAP_NR(page)]++;
+				mi->i_count++;
+				write_mmap_page(mi,from - m->m_start + m->m_offset,page);
+				free_page(page);
+				iput(mi);
+			}
+	}
+}
+
 //执行缺页处理，页异常中断处理过程中调用的函数
 //函数参数error_code和address是进程在访问页面时由CPU因缺页产生异常而自动生成的
 //该函数首先尝试与已加载的相同文件进行页面共享，或者只是由于进程动态申请内存页面而只需映射一页物理内存页即可
 //若共享操作不成功，那么只能从相应文件中读入所缺的数据页面到指定线性地址处
 void do_no_page(unsigned long error_code,unsigned long address)
 {
-	int nr[4];
-	unsigned long tmp;
+	unsigned long tmp,off;
 	unsigned long page;
-	int block,i;
+	struct mmap_struct * m;
+	int i;
 
 	//首先取线性地址空间中指定地址address处页面地址
 	//从而可算出指定线性地址在进程空间中相对于进程基址的偏移长度值tmp，即对应的逻辑地址
 	address &= 0xfffff000;
 	tmp = address - current->start_code;
+	//所缺页面在文件映射区内，从映射的文件中读入
+	if (m = find_mmap(tmp)) {
+		mmap_no_page(m,tmp,address);
+		return;
+	}
 	//若当前进程的executable节点指针为空，
 	//或者指定地址超过(代码+数据)长度，表明进程在申请新的内存页面存放堆或栈中数据，
 	//则申请一页物理内存，并映射到指定的线性地址处
@@ -460,36 +942,46 @@ void do_no_page(unsigned long error_code,unsigned long address)
 		get_empty_page(address);
 		return;
 	}
-	//否则说明所缺页面在进程执行映像文件范围内，于是就尝试共享页面操作，若成功则退出
+	//否则说明所缺页面在进程执行映像文件范围内
+	//页面缓存中有这一页就直接映射，不读盘也不复制
+/* remember that 1 block is used for header */
+	//因为块设备上存放的执行文件映像第1块数据是程序头结构，因此在读取该文件时需要跳过第1块数据
+	//所以缺页在执行映像文件中的位置是进程逻辑地址tmp加上一个数据块的长度
+	//同时映射它周围已在缓存中的页
+	off = BLOCK_SIZE+tmp;
+	if (map_cached_page(current->executable,off,address)) {
+		fault_around(current->executable,tmp);
+		return;
+	}
+	//然后尝试共享页面操作，若成功则退出
 	//若不成功就只能申请一页物理内存页面page，然后从设备上读取执行文件中的相应页面并映射到进程页面逻辑地址tmp处
 	if (share_page(tmp))
 		return;
 	if (!(page = get_free_page()))			//申请一页物理内存
 		oom();
-/* remember that 1 block is used for header */
-	//因为块设备上存放的执行文件映像第1块数据是程序头结构，因此在读取该文件时需要跳过第1块数据
-	//所以需要首先计算缺页所在的数据块号。
-	//因为每块数据长度BLOCK_SIZE=1KM，因此一页内存可存放4个数据块
-	//进程逻辑地址tmp除以数据块大小再加1，即可得出缺少的页面在执行映像文件中的起始块号block
-	block = 1 + tmp/BLOCK_SIZE;
-	//根据这个块号和执行文件的i节点，我们就可以从映射位图中找到对应块设备中对应的设备逻辑块号(保存到nr[]数组中)
-	for (i=0 ; i<4 ; block++,i++)
-		nr[i] = bmap(current->executable,block);
-	//调用bread_page()即可把这4个逻辑块读入到物理页面page中
-	bread_page(page,current->executable->i_dev,nr);
+	//由执行文件所在文件系统的readpage操作把这一页读入到物理页面page中
+	//并为后面几页发出预读
+	current->executable->i_op->readpage(current->executable,off,page);
+	read_ahead(current->executable,tmp);
+	//读盘时可能有别的进程已经把同一页放进了缓存
+	if (map_cached_page(current->executable,off,address)) {
+		free_page(page);
+		fault_around(current->executable,tmp);
+		return;
+	}
 	//在读设备逻辑块操作时，可能会出现这样一种情况
 	//即在执行文件中的读取页面位置可能离文件尾不到1个页面的长度，因此可能读入一些无用的信息
 	//下面把这部分超出执行文件end_data以后的部分清零处理
 	i = tmp + 4096 - current->end_data;
-	tmp = page + 4096;
-	while (i-- > 0) {
-		tmp--;
-		*(char *)tmp = 0;
-	}
-	//最后把引起缺页异常的一页物理页面映射到指定线性地址address处
+	while (i-- > 0)
+		*(char *) (page + 4095 - i) = 0;
+	//最后把引起缺页异常的一页物理页面映射到指定线性地址address处，并留在页面缓存中
 	//若操作成功就返回，否则就释放内存页，显示内存不够
-	if (put_page(page,address))
+	if (put_page(page,address)) {
+		cache_page(current->executable,off,page,address);
+		fault_around(current->executable,tmp);
 		return;
+	}
 	free_page(page);
 	oom();
 }
@@ -0,0 +1,164 @@
+/*
+ *  linux/mm/mmap.c
+ */
+
+/*
+ * Memory-mapped regular files. A mapping is only recorded here: pages
+ * are read in by do_no_page() the first time they are touched, exactly
+ * like demand-loaded executables, and shared pages that were written to
+ * go back to the file when the mapping is torn down.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/segment.h>
+
+//在当前进程的映射区中查找包含逻辑地址addr的一项，没有则返回NULL
+struct mmap_struct * find_mmap(unsigned long addr)
+{
+	struct mmap_struct * m;
+
+	for (m = current->mmap ; m < current->mmap + NR_MMAP ; m++)
+		if (m->m_inode && m->m_start <= addr && addr < m->m_end)
+			return m;
+	return NULL;
+}
+
+//返回与逻辑地址区间[start,end)重叠的第一个映射区
+static struct mmap_struct * overlap_mmap(unsigned long start, unsigned long end)
+{
+	struct mmap_struct * m;
+
+	for (m = current->mmap ; m < current->mmap + NR_MMAP ; m++)
+		if (m->m_inode && m->m_start < end && start < m->m_end)
+			return m;
+	return NULL;
+}
+
+static struct mmap_struct * get_empty_mmap(void)
+{
+	struct mmap_struct * m;
+
+	for (m = current->mmap ; m < current->mmap + NR_MMAP ; m++)
+		if (!m->m_inode)
+			return m;
+	return NULL;
+}
+
+//区间[start,start+len)是否可以用作新映射区
+static int mmap_fits(unsigned long start, unsigned long len)
+{
+	if (start & 0xfff)
+		return 0;
+	if (start < MMAP_START || start + len > MMAP_END || start + len < start)
+		return 0;
+	return !overlap_mmap(start,start+len);
+}
+
+//映射系统调用。参数buffer指向用户空间中的6个长字：addr,len,prot,flags,fd,offset
+//映射地址由内核在MMAP_START-MMAP_END区间内选择，addr只作为提示，除非指定了MAP_FIXED
+//返回映射区的逻辑地址，出错返回出错码
+int sys_mmap(unsigned long * buffer)
+{
+	unsigned long addr,len,off;
+	int prot,flags,fd;
+	struct mmap_struct * m, * n;
+	struct file * file;
+	struct m_inode * inode;
+
+	addr = get_fs_long(buffer);
+	len = get_fs_long(buffer+1);
+	prot = get_fs_long(buffer+2);
+	flags = get_fs_long(buffer+3);
+	fd = get_fs_long(buffer+4);
+	off = get_fs_long(buffer+5);
+	if (fd >= current->max_fds || fd < 0 || !(file=current->filp[fd]))
+		return -EBADF;
+	inode = file->f_inode;
+	if (!S_ISREG(inode->i_mode) || !inode->i_op || !inode->i_op->readpage)
+		return -ENODEV;
+	if ((flags & MAP_TYPE) != MAP_SHARED && (flags & MAP_TYPE) != MAP_PRIVATE)
+		return -EINVAL;
+	if (!len || (off & 0xfff))
+		return -EINVAL;
+	//只写打开的文件不能映射，可写的共享映射要求文件以读写方式打开
+	if ((file->f_flags & O_ACCMODE) == O_WRONLY)
+		return -EACCES;
+	if ((flags & MAP_SHARED) && (prot & PROT_WRITE) &&
+	    (file->f_flags & O_ACCMODE) != O_RDWR)
+		return -EACCES;
+	len = (len + 0xfff) & 0xfffff000;
+	if (!(m = get_empty_mmap()))
+		return -ENOMEM;
+	if (!mmap_fits(addr,len)) {
+		if (flags & MAP_FIXED)
+			return -EINVAL;
+		//首次适配：跳过所有与候选区间重叠的映射区
+		addr = MMAP_START;
+		while (n = overlap_mmap(addr,addr+len))
+			addr = n->m_end;
+		if (addr + len > MMAP_END || addr + len < addr)
+			return -ENOMEM;
+	}
+	m->m_start = addr;
+	m->m_end = addr + len;
+	m->m_offset = off;
+	m->m_prot = prot;
+	m->m_flags = flags;
+	m->m_inode = inode;
+	inode->i_count++;
+	return addr;
+}
+
+//解除[addr,addr+len)中的映射。被部分覆盖的映射区会被截短，中间挖去一段时一分为二
+int sys_munmap(unsigned long addr, unsigned long len)
+{
+	struct mmap_struct * m, * n;
+	unsigned long start,end;
+
+	if ((addr & 0xfff) || !len)
+		return -EINVAL;
+	len = (len + 0xfff) & 0xfffff000;
+	for (m = current->mmap ; m < current->mmap + NR_MMAP ; m++) {
+		if (!m->m_inode || m->m_end <= addr || addr + len <= m->m_start)
+			continue;
+		start = (addr > m->m_start) ? addr : m->m_start;
+		end = (addr + len < m->m_end) ? addr + len : m->m_end;
+		if (start > m->m_start && end < m->m_end) {
+			if (!(n = get_empty_mmap()))
+				return -ENOMEM;
+			*n = *m;
+			n->m_start = end;
+			n->m_offset += end - m->m_start;
+			m->m_inode->i_count++;
+		}
+		unmap_pages(m,start,end);
+		if (start == m->m_start && end == m->m_end) {
+			iput(m->m_inode);
+			m->m_inode = NULL;
+		} else if (start == m->m_start) {
+			m->m_offset += end - m->m_start;
+			m->m_start = end;
+		} else
+			m->m_end = start;
+	}
+	return 0;
+}
+
+//进程退出或执行新程序时解除全部映射，必须在释放页表之前调用
+void exit_mmap(void)
+{
+	struct mmap_struct * m;
+
+	for (m = current->mmap ; m < current->mmap + NR_MMAP ; m++)
+		if (m->m_inode) {
+			unmap_pages(m,m->m_start,m->m_end);
+			iput(m->m_inode);
+			m->m_inode = NULL;
+		}
+}
@@ -0,0 +1,145 @@
+/*
+ *  linux/tools/fsbench/bench.c
+ *
+ * The microbenchmarks. They go in through the system calls, the way a
+ * program would, so each one runs the whole path: namei, the inode and
+ * buffer caches, the bitmaps and the block mapping. "Cold" reads start
+ * with an empty buffer cache; everything else runs on whatever the
+ * previous step left behind.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+
+#include "fsbench.h"
+
+#define DIR "/fsbench"
+#define DATA DIR "/data"
+#define CHUNK 4096
+#define LOOKUP_ROUNDS 4
+
+extern int sys_creat(const char * pathname, int mode);
+extern int sys_open(const char * filename,int flag,int mode);
+extern int sys_close(unsigned int fd);
+extern int sys_read(unsigned int fd,char * buf,int count);
+extern int sys_write(unsigned int fd,char * buf,int count);
+extern int sys_stat(char * filename, struct stat * statbuf);
+extern int sys_mkdir(const char * pathname, int mode);
+extern int sys_rmdir(const char * name);
+extern int sys_unlink(const char * name);
+extern int sys_sync(void);
+extern void invalidate_buffers(int dev);
+
+static char buf[CHUNK] __attribute__ ((aligned (4096)));
+
+//文件名DIR/fN，N是十进制序号
+static char * name(int n)
+{
+	static char s[sizeof(DIR) + 16] = DIR "/f";
+	char digits[12];
+	int i = 0, j = sizeof(DIR) + 1;
+
+	do
+		digits[i++] = '0' + n % 10;
+	while (n /= 10);
+	while (i)
+		s[j++] = digits[--i];
+	s[j] = 0;
+	return s;
+}
+
+static void bench_create(int files)
+{
+	int i,fd;
+
+	fsb_start();
+	for (i=0 ; i<files ; i++) {
+		if ((fd = sys_creat(name(i),0644)) < 0)
+			panic("fsbench: create failed");
+		sys_close(fd);
+	}
+	sys_sync();
+	fsb_stop("create",files,0);
+}
+
+static void bench_lookup(int files)
+{
+	struct stat st;
+	int i,j;
+
+	fsb_start();
+	for (j=0 ; j<LOOKUP_ROUNDS ; j++)
+		for (i=0 ; i<files ; i++)
+			if (sys_stat(name(i),&st))
+				panic("fsbench: lookup failed");
+	fsb_stop("lookup",files*LOOKUP_ROUNDS,0);
+}
+
+static void bench_write(int kbytes)
+{
+	int fd,i;
+
+	for (i=0 ; i<CHUNK ; i++)
+		buf[i] = i;
+	fsb_start();
+	if ((fd = sys_open(DATA,O_CREAT|O_TRUNC|O_WRONLY,0644)) < 0)
+		panic("fsbench: open for write failed");
+	for (i=0 ; i<kbytes ; i += CHUNK/1024)
+		if (sys_write(fd,buf,CHUNK) != CHUNK)
+			panic("fsbench: write failed");
+	sys_close(fd);
+	sys_sync();
+	fsb_stop("seq write",0,kbytes*1024L);
+}
+
+static void bench_read(const char * what, int kbytes, int cold)
+{
+	int fd,n;
+	long total = 0;
+
+	if (cold) {
+		sys_sync();
+		invalidate_buffers(FSB_DEV);
+	}
+	fsb_start();
+	if ((fd = sys_open(DATA,O_RDONLY,0)) < 0)
+		panic("fsbench: open for read failed");
+	while ((n = sys_read(fd,buf,CHUNK)) > 0)
+		total += n;
+	sys_close(fd);
+	if (total != kbytes*1024L)
+		panic("fsbench: short read");
+	fsb_stop(what,0,total);
+}
+
+static void bench_unlink(int files)
+{
+	int i;
+
+	fsb_start();
+	for (i=0 ; i<files ; i++)
+		if (sys_unlink(name(i)))
+			panic("fsbench: unlink failed");
+	sys_sync();
+	fsb_stop("unlink",files,0);
+}
+
+void fsb_run(int files, int kbytes)
+{
+	kbytes &= ~(CHUNK/1024 - 1);
+	if (sys_mkdir(DIR,0755))
+		panic("fsbench: can't make " DIR " (left from an earlier run?)");
+	bench_create(files);
+	bench_lookup(files);
+	bench_write(kbytes);
+	bench_read("seq read cold",kbytes,1);
+	bench_read("seq read warm",kbytes,0);
+	bench_unlink(files);
+	sys_unlink(DATA);
+	sys_rmdir(DIR);
+	sys_sync();
+}
@@ -0,0 +1,28 @@
+/*
+ * fsbench.h - the interface between the two halves of fsbench.
+ *
+ * kernel.c and bench.c are built against the kernel's own headers,
+ * host.c against the host C library; the two can't include each other's
+ * headers, so only plain C types cross here.
+ */
+#ifndef _FSBENCH_H
+#define _FSBENCH_H
+
+#define FSB_DEV		0x301		/* the image is mounted as /dev/hd1 */
+#define FSB_BUFFER_MEM	(2*1024*1024)	/* buffer cache size, as on a 6MB box */
+
+/* host.c */
+extern int fsb_block_io(int write, int block, char * data);
+extern unsigned long fsb_get_page(void);
+extern void fsb_free_page(unsigned long page);
+extern long fsb_time(void);
+extern void fsb_start(void);
+extern void fsb_stop(const char * what, int ops, long bytes);
+
+/* kernel.c */
+extern void fsb_init(void);
+
+/* bench.c */
+extern void fsb_run(int files, int kbytes);
+
+#endif
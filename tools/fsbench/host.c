@@ -0,0 +1,135 @@
+/*
+ *  linux/tools/fsbench/host.c
+ */
+
+/*
+ * fsbench runs the file system code of the kernel (the buffer cache
+ * and the rest of fs/) as an ordinary host program on a minix image
+ * file, so the hot paths can be timed and profiled without booting:
+ *
+ *	mkfs.minix -n 14 -1 image 8192
+ *	fsbench image [files [kbytes]]
+ *
+ * This file is the host side: the image, memory, the clock and the
+ * console. It can't see the kernel headers; see fsbench.h.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "fsbench.h"
+
+#define BLOCK_SIZE 1024
+
+static int image;
+static long reads, writes;
+static struct timeval t0;
+static long reads0, writes0;
+
+void die(char * str)
+{
+	fprintf(stderr,"%s\n",str);
+	exit(1);
+}
+
+void usage(void)
+{
+	die("Usage: fsbench image [files [kbytes]]");
+}
+
+int printk(const char * fmt, ...)
+{
+	va_list args;
+	int i;
+
+	va_start(args,fmt);
+	i = vprintf(fmt,args);
+	va_end(args);
+	return i;
+}
+
+void panic(const char * s)
+{
+	fflush(stdout);
+	fprintf(stderr,"Kernel panic: %s\n",s);
+	abort();
+}
+
+int fsb_block_io(int write, int block, char * data)
+{
+	off_t pos = (off_t) block * BLOCK_SIZE;
+
+	if (write) {
+		writes++;
+		return pwrite(image,data,BLOCK_SIZE,pos) != BLOCK_SIZE;
+	}
+	reads++;
+	return pread(image,data,BLOCK_SIZE,pos) != BLOCK_SIZE;
+}
+
+unsigned long fsb_get_page(void)
+{
+	void * p;
+
+	if (posix_memalign(&p,4096,4096))
+		return 0;
+	return (unsigned long) p;
+}
+
+void fsb_free_page(unsigned long page)
+{
+	free((void *) page);
+}
+
+long fsb_time(void)
+{
+	return time(NULL);
+}
+
+void fsb_start(void)
+{
+	reads0 = reads;
+	writes0 = writes;
+	gettimeofday(&t0,NULL);
+}
+
+void fsb_stop(const char * what, int ops, long bytes)
+{
+	struct timeval t;
+	double s;
+
+	gettimeofday(&t,NULL);
+	s = (t.tv_sec - t0.tv_sec) + (t.tv_usec - t0.tv_usec) / 1e6;
+	printf("%-14s %9.3f ms",what,s * 1e3);
+	if (ops)
+		printf("  %10.0f ops/s",ops / s);
+	if (bytes)
+		printf("  %10.1f MB/s",bytes / s / (1024*1024));
+	printf("  %ld reads, %ld writes\n",reads - reads0,writes - writes0);
+}
+
+int main(int argc, char ** argv)
+{
+	int files = 1000, kbytes = 4096;
+
+	if (argc < 2 || argc > 4)
+		usage();
+	if (argc > 2 && (files = atoi(argv[2])) <= 0)
+		usage();
+	if (argc > 3 && (kbytes = atoi(argv[3])) <= 0)
+		usage();
+	if ((image = open(argv[1],O_RDWR)) < 0)
+		die("Unable to open image");
+/* match() in namei.c compares names with an fs: prefix */
+	__asm__("movw %%ds,%%ax\n\tmovw %%ax,%%fs":::"ax");
+	fsb_init();
+	fsb_run(files,kbytes);
+	close(image);
+	return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * fsbench: the file system code runs as an ordinary process, where the
+ * "user" buffers are in the same address space as everything else. The
+ * %fs accesses of the kernel's asm/segment.h become plain ones.
+ */
+#ifndef _FSBENCH_SEGMENT_H
+#define _FSBENCH_SEGMENT_H
+
+static inline unsigned char get_fs_byte(const char * addr)
+{
+	return *(const unsigned char *) addr;
+}
+
+static inline unsigned short get_fs_word(const unsigned short *addr)
+{
+	return *addr;
+}
+
+static inline unsigned long get_fs_long(const unsigned long *addr)
+{
+	return *addr;
+}
+
+static inline void put_fs_byte(char val,char *addr)
+{
+	*addr = val;
+}
+
+static inline void put_fs_word(short val,short * addr)
+{
+	*addr = val;
+}
+
+static inline void put_fs_long(unsigned long val,unsigned long * addr)
+{
+	*addr = val;
+}
+
+static inline void memcpy_tofs(void * to, const void * from, unsigned long n)
+{
+	__builtin_memcpy(to,from,n);
+}
+
+static inline void memcpy_fromfs(void * to, const void * from, unsigned long n)
+{
+	__builtin_memcpy(to,from,n);
+}
+
+static inline void clear_fs(void * to, unsigned long n)
+{
+	__builtin_memset(to,0,n);
+}
+
+static inline unsigned long get_fs()
+{
+	return 0x17;
+}
+
+static inline unsigned long get_ds()
+{
+	return 0x10;
+}
+
+static inline void set_fs(unsigned long val)
+{
+}
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * fsbench: there are no interrupts to mask; the harness is one
+ * process with one "task", so cli()/sti() have nothing to do.
+ */
+#ifndef _FSBENCH_SYSTEM_H
+#define _FSBENCH_SYSTEM_H
+
+#define sti()
+#define cli()
+#define nop()
+
+#endif
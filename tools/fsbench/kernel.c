@@ -0,0 +1,205 @@
+/*
+ *  linux/tools/fsbench/kernel.c
+ *
+ * The parts of the kernel that fs/ expects around it, cut down to what
+ * a single process needs: one task, no interrupts, and a block device
+ * that is a file on the host. Every request completes before
+ * ll_rw_block() returns, so nothing ever has a reason to sleep; if
+ * something does, the harness would hang, and it panics instead.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/tty.h>
+#include <linux/mm.h>
+
+#include "fsbench.h"
+
+extern void buffer_init(long buffer_end);
+extern void mount_root(void);
+extern int ROOT_DEV;
+
+static struct task_struct fsb_task;
+struct task_struct * current = &fsb_task;
+long volatile jiffies = 0;
+long startup_time = 0;
+struct tty_struct tty_table[1];
+
+/* the buffer cache lives here: buffer.c is built with -Dend=fsbench_buffers */
+char fsbench_buffers[FSB_BUFFER_MEM] __attribute__ ((aligned (4096)));
+
+void sleep_on(struct task_struct ** p)
+{
+	panic("fsbench: sleep_on() would never return");
+}
+
+void interruptible_sleep_on(struct task_struct ** p)
+{
+	panic("fsbench: interruptible_sleep_on() would never return");
+}
+
+void wake_up(struct task_struct ** p)
+{
+	if (p && *p) {
+		(**p).state = 0;
+		*p = NULL;
+	}
+}
+
+void schedule(void)
+{
+}
+
+/*
+ * The same checks as make_request(), then the transfer itself, done on
+ * the spot. A block pinned in a journal transaction isn't written, as
+ * in the real ll_rw_block().
+ */
+void ll_rw_block(int rw, struct buffer_head * bh)
+{
+	if ((rw == WRITE || rw == WRITEA) && bh->b_jtrans)
+		return;
+	if (rw == READA || rw == WRITEA) {
+		if (bh->b_lock)
+			return;
+		rw = (rw == READA) ? READ : WRITE;
+	}
+	if ((rw == WRITE && !bh->b_dirt) || (rw == READ && bh->b_uptodate))
+		return;
+	if (bh->b_dev != FSB_DEV) {
+		printk("Trying to read nonexistent block-device\n\r");
+		return;
+	}
+	if (fsb_block_io(rw == WRITE,bh->b_blocknr,bh->b_data))
+		bh->b_uptodate = 0;
+	else {
+		bh->b_uptodate = 1;
+		if (rw == WRITE)
+			bh->b_dirt = 0;
+	}
+	wake_up(&bh->b_wait);
+}
+
+int is_read_only(int dev)
+{
+	return 0;
+}
+
+int floppy_change(unsigned int nr)
+{
+	return 0;
+}
+
+void wait_for_keypress(void)
+{
+}
+
+void verify_area(void * addr,int count)
+{
+}
+
+/*
+ * "User" memory is the harness's own, so a user page is pinned by just
+ * remembering it: free_page() drops the pin instead of freeing it.
+ */
+#define NR_PINNED 64
+
+static struct {
+	unsigned long page;
+	int count;
+} pinned[NR_PINNED];
+
+unsigned long pin_user_page(unsigned long addr, int write)
+{
+	int i,free = -1;
+
+	addr &= 0xfffff000;
+	for (i=0 ; i<NR_PINNED ; i++)
+		if (pinned[i].count && pinned[i].page == addr) {
+			pinned[i].count++;
+			return addr;
+		} else if (!pinned[i].count && free < 0)
+			free = i;
+	if (free < 0)
+		return 0;
+	pinned[free].page = addr;
+	pinned[free].count = 1;
+	return addr;
+}
+
+unsigned long get_free_page(void)
+{
+	unsigned long page = fsb_get_page();
+
+	if (page)
+		memset((void *) page,0,4096);
+	return page;
+}
+
+void free_page(unsigned long addr)
+{
+	int i;
+
+	for (i=0 ; i<NR_PINNED ; i++)
+		if (pinned[i].count && pinned[i].page == addr) {
+			pinned[i].count--;
+			return;
+		}
+	fsb_free_page(addr);
+}
+
+/* nothing runs programs here, so there is no page cache to drop */
+void invalidate_pages(int dev, int ino)
+{
+}
+
+/* and no mappings to write back */
+void sync_mmap(struct m_inode * inode)
+{
+}
+
+/* no character devices or pipes behind the benchmarks */
+int rw_char(int rw,int dev, char * buf, int count, off_t * pos,
+	unsigned short flags)
+{
+	return -ENODEV;
+}
+
+int read_pipe(struct m_inode * inode, char * buf, int count,
+	unsigned short flags)
+{
+	return -EINVAL;
+}
+
+int write_pipe(struct m_inode * inode, char * buf, int count,
+	unsigned short flags)
+{
+	return -EINVAL;
+}
+
+int pipe_set_pages(struct m_inode * inode, int pages)
+{
+	return -EINVAL;
+}
+
+/*
+ * What main() and init() would do for the file system: set up the
+ * buffer cache, make the harness task 1's equal, and mount the image
+ * as the root.
+ */
+void fsb_init(void)
+{
+	startup_time = fsb_time();
+	fsb_task.tty = -1;
+	fsb_task.umask = 0022;
+	fsb_task.pid = 1;
+	fsb_task.filp = fsb_task.init_filp;
+	fsb_task.max_fds = NR_OPEN_DEFAULT;
+	fsb_task.close_on_exec = &fsb_task.init_close_on_exec;
+	buffer_init((long) (fsbench_buffers + FSB_BUFFER_MEM));
+	ROOT_DEV = FSB_DEV;
+	mount_root();
+}
@@ -0,0 +1,141 @@
+/*
+ *  linux/tools/rdzip.c
+ */
+
+/*
+ * This file makes a compressed ram disk image out of a minix file system
+ * image. Every 1k block is compressed on its own, so the kernel can
+ * decompress any block when it is read (see kernel/blk_drv/ramdisk.c,
+ * which must agree with the layout written here):
+ *
+ * - header: magic, number of blocks, length of the whole image
+ * - nblocks+1 offsets from the start of the image, one per block
+ * - the blocks: lzss data, or the plain 1024 bytes if that is smaller
+ *
+ * All numbers are 32 bits, little endian. The result goes to stdout and
+ * is put on the boot disk at block 256, where rd_load() looks for it.
+ */
+
+#include <stdio.h>	/* fprintf */
+#include <string.h>
+#include <stdlib.h>	/* contains exit */
+#include <sys/types.h>	/* unistd.h needs this */
+#include <sys/stat.h>
+#include <unistd.h>	/* contains read/write */
+#include <fcntl.h>
+
+#define BLOCK_SIZE 1024
+#define RD_ZMAGIC 0x7a64
+#define HEADER 12
+
+#define MAX_DIST 4095
+#define MIN_MATCH 3
+#define MAX_MATCH 18
+
+void die(char * str)
+{
+	fprintf(stderr,"%s\n",str);
+	exit(1);
+}
+
+void usage(void)
+{
+	die("Usage: rdzip minix-image [> image]");
+}
+
+void put_long(unsigned char * p, unsigned long n)
+{
+	p[0] = n;
+	p[1] = n >> 8;
+	p[2] = n >> 16;
+	p[3] = n >> 24;
+}
+
+/*
+ * Greedy lzss over one block. Returns the compressed length, or
+ * BLOCK_SIZE when the block doesn't get smaller (out is then unused).
+ */
+int compress(unsigned char * in, unsigned char * out)
+{
+	int i,j,len,best,dist,n,item;
+	unsigned char * flags;
+
+	n = 0;
+	item = 8;
+	for (i=0 ; i<BLOCK_SIZE ; ) {
+		if (item == 8) {
+			if (n >= BLOCK_SIZE-1)
+				return BLOCK_SIZE;
+			flags = out + n++;
+			*flags = 0;
+			item = 0;
+		}
+		best = dist = 0;
+		for (j = (i > MAX_DIST) ? i-MAX_DIST : 0 ; j < i ; j++) {
+			for (len=0 ; len<MAX_MATCH && i+len<BLOCK_SIZE &&
+			     in[j+len] == in[i+len] ; len++)
+				/* nothing */ ;
+			if (len > best) {
+				best = len;
+				dist = i-j;
+			}
+		}
+		if (best >= MIN_MATCH) {
+			if (n+2 >= BLOCK_SIZE)
+				return BLOCK_SIZE;
+			out[n++] = dist;
+			out[n++] = ((dist >> 4) & 0xf0) | (best-MIN_MATCH);
+			i += best;
+		} else {
+			if (n+1 >= BLOCK_SIZE)
+				return BLOCK_SIZE;
+			*flags |= 1 << item;
+			out[n++] = in[i++];
+		}
+		item++;
+	}
+	return n;
+}
+
+int main(int argc, char ** argv)
+{
+	int id,i,nblocks,len;
+	unsigned char * data, * table, * zdata;
+	unsigned long pos;
+	struct stat sb;
+
+	if (argc != 2)
+		usage();
+	if ((id=open(argv[1],O_RDONLY,0))<0)
+		die("Unable to open image");
+	if (fstat(id,&sb))
+		die("Unable to stat image");
+	if (!sb.st_size || (sb.st_size % BLOCK_SIZE))
+		die("Image is not a whole number of blocks");
+	nblocks = sb.st_size / BLOCK_SIZE;
+	if (!(data = malloc(sb.st_size)) ||
+	    !(table = malloc(HEADER + 4*(nblocks+1))) ||
+	    !(zdata = malloc(sb.st_size)))
+		die("Out of memory");
+	if (read(id,data,sb.st_size) != sb.st_size)
+		die("Unable to read image");
+	close(id);
+	pos = HEADER + 4*(nblocks+1);
+	len = 0;
+	for (i=0 ; i<nblocks ; i++) {
+		put_long(table + HEADER + 4*i,pos+len);
+		id = compress(data + i*BLOCK_SIZE,zdata + len);
+		if (id == BLOCK_SIZE)
+			memcpy(zdata + len,data + i*BLOCK_SIZE,BLOCK_SIZE);
+		len += id;
+	}
+	put_long(table + HEADER + 4*nblocks,pos+len);
+	put_long(table,RD_ZMAGIC);
+	put_long(table+4,nblocks);
+	put_long(table+8,pos+len);
+	if (write(1,table,pos) != pos || write(1,zdata,len) != len)
+		die("Write call failed");
+	fprintf(stderr,"Ram disk image: %d blocks, %lu bytes compressed\n",
+		nblocks,pos+len);
+	return(0);
+}